@@ -13,14 +13,24 @@
 #include <QRadiobutton>
 #include <QThread>
 #include <QSettings>
-#include <QListWidget>
-#include <QListWidgetItem>
+#include <QListView>
+#include <QFileSystemWatcher>
+#include <QTimer>
 #include <QImageReader>
 #include <QWheelEvent>
 #include <QApplication>
 #include <opencv2/opencv.hpp>
 #include <QCheckBox>
 #include "ascii_converter.h"
+#include "image_cache.h"
+#include "image_loader.h"
+#include "image_decoder.h"
+#include "mapped_file.h"
+#include "filter_pipeline.h"
+#include "filter_worker.h"
+#include "thumbnail_store.h"
+#include "image_list_model.h"
+#include "directory_scanner.h"
 #include "QProcess"
 #include <memory>
 #include <random>
@@ -28,15 +38,84 @@
 
 
 
-// helper converter from cv::Mat to QPixmap
-static QPixmap cv_to_qpixmap_converter(cv::Mat& cv_img)
+// helper converter from a BGR or grayscale cv::Mat to QPixmap
+// the Mat is left untouched, filter results are cached and may be shown again
+// the pixels are wrapped as they are, QPixmap makes the only copy
+static QPixmap cv_to_qpixmap_converter(const cv::Mat& cv_img)
 {
-    cv::cvtColor(cv_img, cv_img, cv::COLOR_BGR2RGB);
-    QImage qimage(cv_img.data, cv_img.cols, cv_img.rows, cv_img.step, QImage::Format_RGB888);
+    QImage::Format format = cv_img.channels() == 1 ? QImage::Format_Grayscale8 : QImage::Format_BGR888;
+    QImage qimage(cv_img.data, cv_img.cols, cv_img.rows, cv_img.step, format);
 
     return QPixmap::fromImage(qimage);
 }
 
+// wraps a BGR or grayscale cv::Mat in a read only QImage without copying the pixels
+// the QImage holds a reference to the Mat's buffer, so it stays valid on its own
+static QImage cv_to_qimage(const cv::Mat& cv_img)
+{
+    if (cv_img.empty())
+    {
+        return QImage();
+    }
+
+    QImage::Format format = cv_img.channels() == 1 ? QImage::Format_Grayscale8 : QImage::Format_BGR888;
+    cv::Mat* owner = new cv::Mat(cv_img);
+
+    return QImage(const_cast<const uchar*>(owner->data), owner->cols, owner->rows, owner->step, format,
+        [](void* mat) { delete static_cast<cv::Mat*>(mat); }, owner);
+}
+
+// wraps a QImage in a cv::Mat header without copying the pixels
+// 32 bit formats are BGRA in memory on little endian machines, anything else is converted once
+// the returned Mat is only valid while the QImage is alive and unmodified, and must not be written to
+static cv::Mat qimage_to_cv_view(QImage& image)
+{
+    switch (image.format())
+    {
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+
+    default:
+        image = image.convertToFormat(QImage::Format_RGB32);
+        break;
+    }
+
+    // constBits() avoids detaching (deep copying) an image that is shared with the cache
+    uchar* pixels = const_cast<uchar*>(image.constBits());
+    int type = image.format() == QImage::Format_Grayscale8 ? CV_8UC1 : CV_8UC4;
+
+    return cv::Mat(image.height(), image.width(), type, pixels, image.bytesPerLine());
+}
+
+// BGR copy for the OpenCV filters, same layout cv::imread gave them
+// takes its own reference to the image, so it can run on the filter thread
+static cv::Mat qimage_to_bgr(QImage image)
+{
+    if (image.isNull())
+    {
+        return cv::Mat();
+    }
+
+    cv::Mat view = qimage_to_cv_view(image);
+    cv::Mat bgr;
+    cv::cvtColor(view, bgr, view.channels() == 1 ? cv::COLOR_GRAY2BGR : cv::COLOR_BGRA2BGR);
+
+    return bgr;
+}
+
+// queues a step for the full resolution and the preview stack, the filter thread owns both
+static void post_filter_step(FilterWorker& worker, FilterPipeline* pipeline, FilterPipeline* preview_pipeline, const FilterPipeline::Step& step)
+{
+    worker.post([pipeline, preview_pipeline, step]()
+    {
+        pipeline->set_step(step);
+        preview_pipeline->set_step(step);
+    });
+}
+
 
 // shorten the url to just the file name for display purposes
 static QString truncate_url_to_image_name(const QString& path)
@@ -59,26 +138,6 @@ static QString set_info_string(int index, int n_files, const QString& file_name)
 
 // check if the folder has files in it
 
-static bool check_for_known_file_types(const QString& folder)
-{
-    QDir dir(folder);
-
-    //File types
-    QStringList filters = {"*.png", "*.jpg", "*.jpeg", "*.bmp", "*.gif", "*.tiff", "*.webp", "*.psd"};
-
-    QStringList files = dir.entryList(filters, QDir::Files); // filtering the files with the right extensions
-
-    if (files.size() > 0)
-    {
-        return true;
-    }
-
-    else
-    {
-        return false;
-    }
-}
-
 //////////////////////////////////////// class definition
 
 ImageViewer::ImageViewer(QWidget* parent)
@@ -108,6 +167,38 @@ ImageViewer::ImageViewer(QWidget* parent)
     m_current_index = 0;
 
     m_ascii_converter = std::make_unique<ASCIIConverter>(100);
+    m_filter_pipeline = std::make_unique<FilterPipeline>();
+    m_preview_pipeline = std::make_unique<FilterPipeline>();
+    m_filter_worker = std::make_unique<FilterWorker>();
+
+    // memory of the filter stack in MB: the BGR source, the cached stages and the band buffers
+    // (the preview pipeline's images are small anyway)
+    qint64 filter_megabytes = m_settings.value("filter_memory_mb", 1024).toLongLong();
+    m_filter_pipeline->set_memory_budget(filter_megabytes * 1024 * 1024);
+
+    // decoded image budget in MB, can be changed in the settings file
+    qint64 cache_megabytes = m_settings.value("image_cache_mb", 768).toLongLong();
+    m_image_cache = std::make_unique<ImageCache>(cache_megabytes * 1024 * 1024);
+
+    m_prefetch_count = m_settings.value("prefetch_count", 3).toInt();
+    m_image_loader = std::make_unique<ImageLoader>(m_scaled_max_dimension_x, m_scaled_max_dimension_y);
+    m_thumbnail_store = std::make_unique<ThumbnailStore>();
+
+    m_file_list_model = new ImageListModel(this);
+    m_directory_scanner = new DirectoryScanner(this);
+    m_folder_watcher = new QFileSystemWatcher(this);
+
+    // recursive listing, depth and exclude patterns can be changed in the settings file
+    DirectoryScanner::Options scan_options;
+    scan_options.recursive = m_settings.value("recursive_scan", false).toBool();
+    scan_options.max_depth = m_settings.value("scan_max_depth", 16).toInt();
+    scan_options.exclude_patterns = m_settings.value("scan_exclude_patterns", QStringList()).toStringList();
+    m_directory_scanner->set_options(scan_options);
+
+    m_folder_refresh_timer = new QTimer(this);
+    m_folder_refresh_timer->setSingleShot(true);
+    m_folder_refresh_timer->setInterval(300);
+    m_number_of_files = 0;
 
     build_UI();
     connect_buttons();    
@@ -126,10 +217,17 @@ void ImageViewer::build_UI()
 
     // file layout
     m_file_layout = new QVBoxLayout();
-    m_file_list_widget = new QListWidget();
+    m_file_list_view = new QListView();
+    m_file_list_view->setModel(m_file_list_model);
+    m_file_list_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
     // dynamically set max width of the list widget
-    m_file_list_widget->setMaximumWidth(m_scaled_max_dimension_y * 0.35);
+    m_file_list_view->setMaximumWidth(m_scaled_max_dimension_y * 0.35);
+
+    // thumbnails are painted straight from the store, only for the rows on screen
+    m_file_list_view->setIconSize(QSize(ThumbnailStore::thumbnail_edge, ThumbnailStore::thumbnail_edge));
+    m_file_list_view->setUniformItemSizes(true); // row geometry is never computed per item
+    m_file_list_view->setItemDelegate(new ThumbnailDelegate(m_thumbnail_store.get(), m_file_list_view));
 
     m_file_buttons_layout = new QHBoxLayout;
 
@@ -138,7 +236,11 @@ void ImageViewer::build_UI()
     m_file_buttons_layout->addWidget(m_open_folder_button);
     m_file_buttons_layout->addWidget(m_rescan_folder_button);
 
-    m_file_layout->addWidget(m_file_list_widget);
+    m_recursive_checkbox = new QCheckBox("Include subfolders", this);
+    m_recursive_checkbox->setChecked(m_directory_scanner->get_options().recursive);
+    m_file_buttons_layout->addWidget(m_recursive_checkbox);
+
+    m_file_layout->addWidget(m_file_list_view);
     m_file_layout->addLayout(m_file_buttons_layout);   
     
     // image layout
@@ -195,15 +297,18 @@ void ImageViewer::build_UI()
     QGroupBox* blur_group = new QGroupBox("Blur");
     QVBoxLayout* blur_layout = new QVBoxLayout();
     m_blur_label = new QLabel(this);
-    m_blur_label->setText(QString("Blur value: %1").arg(m_blur_value));
+    m_blur_label->setText(QString("Blur sigma: %1").arg(m_blur_value));
     m_blur_button = new QPushButton("Apply blur", this);
     m_blur_slider = new QSlider(Qt::Horizontal, this);
-    m_blur_slider->setRange(3, 51);
+    m_blur_slider->setRange(1, 100); // the box stack costs the same at any sigma
     m_blur_slider->setSingleStep(1);    
     m_blur_slider->setValue(m_blur_value);
+    m_fast_blur_checkbox = new QCheckBox("Fast blur", this); // fewer, 8 bit box passes
+    m_fast_blur_checkbox->setChecked(false);
     blur_layout->addWidget(m_blur_button);
     blur_layout->addWidget(m_blur_label);    
     blur_layout->addWidget(m_blur_slider);
+    blur_layout->addWidget(m_fast_blur_checkbox);
     blur_group->setLayout(blur_layout);
 
     // sharpen layout
@@ -286,11 +391,16 @@ void ImageViewer::build_UI()
 void ImageViewer::connect_buttons()
 {
     // List widget click
-    connect(m_file_list_widget, &QListWidget::itemClicked, this, &ImageViewer::display_clicked_image);
+    connect(m_file_list_view, &QListView::clicked, this, &ImageViewer::display_clicked_image);
 
     // Open folder button
     connect(m_open_folder_button, &QPushButton::clicked, this, &ImageViewer::on_open_folder_button_pressed);  
-    connect(m_rescan_folder_button, &QPushButton::clicked, this, &ImageViewer::load_images_to_list);
+    connect(m_rescan_folder_button, &QPushButton::clicked, this, &ImageViewer::refresh_folder);
+    connect(m_recursive_checkbox, &QCheckBox::toggled, this, &ImageViewer::on_recursive_checkbox_toggled);
+
+    // files added, removed or renamed in the source folder, restarting the timer debounces bursts
+    connect(m_folder_watcher, &QFileSystemWatcher::directoryChanged, m_folder_refresh_timer, qOverload<>(&QTimer::start));
+    connect(m_folder_refresh_timer, &QTimer::timeout, this, &ImageViewer::refresh_folder);
 
     // Reset image
     connect(m_reset_image_button, &QPushButton::clicked, this, &ImageViewer::on_reset_image_button_pressed);
@@ -300,6 +410,9 @@ void ImageViewer::connect_buttons()
     connect(m_contour_slider_A, &QSlider::valueChanged, this, &ImageViewer::get_contour_slider_A_value);
     connect(m_contour_slider_B, &QSlider::valueChanged, this, &ImageViewer::get_contour_slider_B_value);
     connect(m_contour_slider_blur, &QSlider::valueChanged, this, &ImageViewer::get_contour_slider_blur_value);
+    connect(m_contour_slider_A, &QSlider::sliderReleased, this, &ImageViewer::on_filter_slider_released);
+    connect(m_contour_slider_B, &QSlider::sliderReleased, this, &ImageViewer::on_filter_slider_released);
+    connect(m_contour_slider_blur, &QSlider::sliderReleased, this, &ImageViewer::on_filter_slider_released);
 
     // Grayscale filter
     connect(m_gray_button, &QPushButton::clicked, this, &ImageViewer::on_convert_to_grayscale_button_pressed);
@@ -307,10 +420,13 @@ void ImageViewer::connect_buttons()
     // Blur filter
     connect(m_blur_button, &QPushButton::clicked, this, &ImageViewer::blur_image);
     connect(m_blur_slider, &QSlider::valueChanged, this, &ImageViewer::get_blur_slider_value);
+    connect(m_blur_slider, &QSlider::sliderReleased, this, &ImageViewer::on_filter_slider_released);
+    connect(m_fast_blur_checkbox, &QCheckBox::toggled, this, &ImageViewer::get_fast_blur_checkbox_state_changed);
 
     // Sharpen button
     connect(m_sharpen_button, &QPushButton::clicked, this, &ImageViewer::sharpen);
     connect(m_sharpen_slider, &QSlider::valueChanged, this, &ImageViewer::get_sharpen_slider_value);
+    connect(m_sharpen_slider, &QSlider::sliderReleased, this, &ImageViewer::on_filter_slider_released);
 
     // Invert filter
     connect(m_invert_button, &QPushButton::clicked, this, &ImageViewer::invert_image);
@@ -330,18 +446,26 @@ void ImageViewer::connect_buttons()
     connect(m_flip_vertical_button, &QPushButton::clicked, this, &ImageViewer::flip_verical);
 
     // Add double click event to the file-list widget
-    connect(m_file_list_widget, &QListWidget::itemDoubleClicked, this, &ImageViewer::on_list_widget_item_clicked);
+    connect(m_file_list_view, &QListView::doubleClicked, this, &ImageViewer::on_list_widget_item_clicked);
 
     connect(m_ascii_color_checkbox, &QCheckBox::toggled, this, &ImageViewer::get_ascii_color_checkbox_state_changed);
 
     connect(m_random_image_button, &QPushButton::clicked, this, &ImageViewer::on_get_random_image_button_pressed);
+
+    // decoding happens on the loader's threads, results come back here
+    connect(m_image_loader.get(), &ImageLoader::image_loaded, this, &ImageViewer::on_image_loaded);
+    connect(m_image_loader.get(), &ImageLoader::image_ready, this, &ImageViewer::on_prefetched_image_ready);
+
+    connect(m_thumbnail_store.get(), &ThumbnailStore::thumbnail_ready, m_file_list_view->viewport(), qOverload<>(&QWidget::update));
+
+    // the folder listing streams in from the scanner's thread
+    connect(m_directory_scanner, &DirectoryScanner::files_found, this, &ImageViewer::on_files_found);
+    connect(m_directory_scanner, &DirectoryScanner::finished, this, &ImageViewer::on_scan_finished);
     
 }
 
 void ImageViewer::on_open_folder_button_pressed()
 {
-    m_file_list_container.clear();  // Clearing the current list of urls
-    m_file_list_widget->clear();
     // reset flip states
     reset_image_transforms();
 
@@ -353,34 +477,30 @@ void ImageViewer::on_open_folder_button_pressed()
     // if a folder isn't selected 
     if (folder.isEmpty())
     {
+        m_directory_scanner->cancel();
+        m_scan_running = false;
+        m_folder_refresh_timer->stop();
+
+        if (!m_folder_watcher->directories().isEmpty())
+        {
+            m_folder_watcher->removePaths(m_folder_watcher->directories());
+        }
+
+        m_file_list_model->reset(QString());
+        m_number_of_files = 0;
+
         disable_image_controls();
         m_image_info_label->setText("No images found in current folder");
         m_image_display_label->setText("Current folder does not contain images");
-        m_file_list_widget->clear();
 
         return;      
     }
 
-    // set folder even if it's empty
-    bool has_images = check_for_known_file_types(folder);
+    // set folder even if it's empty, the scan reports when there are no images
     m_settings.setValue("source_folder", folder);
     m_source_folder = folder;
 
-    // if the folder has known file formats then load the list
-    if (has_images)
-    {
-        load_images_to_list();            
-    }    
-
-    // otherwise just display warnings
-    else
-    {
-        m_image_info_label->setText("No images found in current folder");
-        m_image_display_label->setText("Current folder does not contain images");
-        m_file_list_widget->clear();
-
-        disable_image_controls();
-    }
+    load_images_to_list();
 }
 
 
@@ -388,8 +508,9 @@ void ImageViewer::on_open_folder_button_pressed()
 void ImageViewer::load_images_to_list()
 {
     
-    m_file_list_container.clear();  // Clearing the current list of urls
-    m_file_list_widget->clear();
+    m_image_loader->cancel_all();
+    m_file_list_model->reset(m_source_folder);
+    m_number_of_files = 0;
     // reset flip states
     reset_image_transforms();
 
@@ -403,56 +524,178 @@ void ImageViewer::load_images_to_list()
         qDebug() << "Source folder does not exist!";
     }
 
-    bool has_files = check_for_known_file_types(m_source_folder);
+    m_thumbnail_store->open_folder(m_source_folder);
 
-    if(has_files)
+    // later changes come in through the watcher instead of full rescans
+    // (top folder only, watching every directory of a large tree would exhaust the inotify watches)
+    if (!m_folder_watcher->directories().isEmpty())
     {
-        //File types
-        QStringList filters = {"*.png", "*.jpg", "*.jpeg", "*.bmp", "*.gif", "*.tiff", "*.webp"};
-
-        QStringList files = dir.entryList(filters, QDir::Files); // filtering the files with the right extensions
+        m_folder_watcher->removePaths(m_folder_watcher->directories());
+    }
 
-        for (const QString& file_name : files)
-        {
-            QString full_path = dir.absoluteFilePath(file_name); // reconstruct the full path for each file
-            m_file_list_container.append(full_path);
-            m_file_list_widget->addItem(file_name);
-        }
+    if (dir.exists())
+    {
+        m_folder_watcher->addPath(m_source_folder);
+    }
 
-        auto first_item = m_file_list_container[0];
+    // the listing arrives in batches, the first image is shown as soon as it is found
+    ++m_scan_generation;
+    m_scan_running = true;
+    m_refresh_pending = false;
+    m_directory_scanner->start(m_source_folder, m_scan_generation);
 
-        if (first_item != "")
-        {
-            m_current_filepath = first_item;
-            load_image(0);
-            m_current_index = 0;
-            m_file_list_widget->setCurrentRow(0);
+    m_image_info_label->setText("Scanning folder...");
+}
 
+void ImageViewer::on_files_found(quint64 generation, const QStringList& names)
+{
+    // batch of a folder that was left already
+    if (generation != m_scan_generation)
+    {
+        return;
+    }
 
+    bool first_batch = m_file_list_model->size() == 0;
 
-            // store total files number
-            m_number_of_files = m_file_list_container.size();
+    m_file_list_model->append(names);
+    m_number_of_files = m_file_list_model->size();
 
-            // enable the buttons and sliders
-            enable_image_controls();
-                  
+    if (first_batch)
+    {
+        m_current_index = 0;
+        m_file_list_view->setCurrentIndex(m_file_list_model->index(0));
 
+        // enable the buttons and sliders
+        enable_image_controls();
+        m_image_display_label->setStyleSheet("border: 2px solid gray;");
 
-            // refresh info for the first image
-            auto first_image_name = truncate_url_to_image_name(first_item);
-            QString image_info = set_info_string(m_current_index + 1, m_number_of_files, first_image_name);
-            m_image_info_label->setText(image_info);
-            m_image_display_label->setStyleSheet("border: 2px solid gray;");
-        }
+        load_image(0);
     }
 
     else
     {
+        // keep the file count in the info up to date while the scan runs
+        QString image_info = set_info_string(m_current_index + 1, m_number_of_files, truncate_url_to_image_name(m_current_filepath));
+        m_image_info_label->setText(image_info);
+    }
+}
+
+void ImageViewer::on_scan_finished(quint64 generation, const QStringList& sorted_names)
+{
+    if (generation != m_scan_generation)
+    {
+        return;
+    }
+
+    m_scan_running = false;
+
+    // more changes arrived while listing, go again once they settle
+    if (m_refresh_pending)
+    {
+        m_refresh_pending = false;
+        m_folder_refresh_timer->start();
+    }
+
+    // an image of this folder is on screen once the first batch was shown
+    bool showing_listed_image = m_file_list_model->size() > 0;
+    QString current_name = m_file_list_model->relative_name(m_current_filepath); // may include subfolders
+
+    // only the differences touch the list, so the selection and scroll position survive
+    QStringList removed;
+    QStringList added;
+    m_file_list_model->sync(sorted_names, removed, added);
+    m_number_of_files = m_file_list_model->size();
+
+    for (const QString& name : removed)
+    {
+        QString path = m_file_list_model->folder() + name;
+        m_image_cache->remove(path);
+        m_thumbnail_store->remove(path);
+    }
+
+    if (m_number_of_files == 0)
+    {
+        m_image_loader->cancel_all();
         m_image_info_label->setText("No images found in current folder");
         m_image_display_label->setText("Current folder does not contain images");
         disable_image_controls();
+
+        return;
+    }
+
+    int current_row = showing_listed_image ? m_file_list_model->find(current_name) : -1;
+
+    // the image on screen was renamed, follow it, the pixels didn't change
+    if (current_row < 0 && showing_listed_image && removed.size() == 1 && added.size() == 1 && removed[0] == current_name)
+    {
+        current_row = m_file_list_model->find(added[0]);
+        m_current_filepath = m_file_list_model->path(current_row);
+    }
+
+    if (current_row >= 0)
+    {
+        m_current_index = current_row;
+        m_file_list_view->setCurrentIndex(m_file_list_model->index(m_current_index));
+
+        QString image_info = set_info_string(m_current_index + 1, m_number_of_files, truncate_url_to_image_name(m_current_filepath));
+        m_image_info_label->setText(image_info);
+
+        // the neighbours may be different files now
+        schedule_prefetch();
     }
 
+    else
+    {
+        // the image on screen was deleted (or nothing was shown yet), move to the one now in its place
+        m_current_index = qBound(0, m_current_index, m_number_of_files - 1);
+        m_file_list_view->setCurrentIndex(m_file_list_model->index(m_current_index));
+
+        enable_image_controls();
+        m_image_display_label->setStyleSheet("border: 2px solid gray;");
+
+        clear_modified_image();
+        load_image(m_current_index);
+    }
+}
+
+void ImageViewer::on_recursive_checkbox_toggled(bool checked)
+{
+    QSettings m_settings;
+    m_settings.setValue("recursive_scan", checked);
+
+    DirectoryScanner::Options scan_options = m_directory_scanner->get_options();
+    scan_options.recursive = checked;
+    m_directory_scanner->set_options(scan_options);
+
+    // a different set of files, list the folder from scratch
+    if (!m_source_folder.isEmpty())
+    {
+        load_images_to_list();
+    }
+}
+
+void ImageViewer::refresh_folder()
+{
+    if (m_source_folder.isEmpty())
+    {
+        return;
+    }
+
+    // don't restart a running scan, a folder that changes constantly would never finish listing
+    if (m_scan_running)
+    {
+        m_refresh_pending = true;
+        return;
+    }
+
+    // files rewritten in place keep their names, the thumbnails are checked against them again
+    m_thumbnail_store->revalidate();
+    m_file_list_view->viewport()->update();
+
+    // a quiet listing, the result is merged into the list instead of rebuilding it
+    ++m_scan_generation;
+    m_scan_running = true;
+    m_directory_scanner->start(m_source_folder, m_scan_generation, false);
 }
 
 
@@ -484,19 +727,9 @@ void ImageViewer::check_settings()
 {
     qDebug() << "Current source folder" << m_source_folder;
 
-    bool has_images = check_for_known_file_types(m_source_folder);
-
-    if(has_images)
+    if (!m_source_folder.isEmpty() && QDir(m_source_folder).exists())
     {
         load_images_to_list();
-
-        auto initial_path = m_file_list_container[0];
-        initial_path = truncate_url_to_image_name(initial_path);
-
-        // info for the current image
-        QString image_info = set_info_string(m_current_index + 1, m_number_of_files, initial_path);
-
-        m_image_info_label->setText(image_info);
     }
 
     else
@@ -509,67 +742,20 @@ void ImageViewer::check_settings()
     
 }
 
-void ImageViewer::display_clicked_image(QListWidgetItem* list_object)
+void ImageViewer::display_clicked_image(const QModelIndex& index)
 {
-    auto text = list_object->text(); // get the text 
-    
-
-    auto row = m_file_list_widget->row(list_object);// getting the row in the widget
+    auto row = index.row();// getting the row in the list
 
-    if (row >= 0 && row < m_file_list_container.size())
+    if (row >= 0 && row < m_file_list_model->size())
     {
         m_current_index = row; //set the current index on selected        
 
-        auto url = m_file_list_container[row]; // contains the full paths already
-        m_current_filepath = url;
-
-        QPixmap mypix_qt(url);
-        // check if it's loaded in the QPixmap object
-
-        if (!mypix_qt.isNull())
-        {
-            m_image_display_label->setPixmap(scale_image_to_fit(mypix_qt));
-
-            // set info
-            QString image_info = set_info_string(m_current_index + 1, m_number_of_files, text);
-            m_image_info_label->setText(image_info);
-
-            // store current image
-            m_current_image = mypix_qt;
-        }
-            
-        else
-        {
-            handle_image_with_cv(url, text);
-        }
+        clear_modified_image();
+        load_image(row);
     }      
         
  }    
     
-void ImageViewer::handle_image_with_cv(const QString& url, const QString& text)
-{
-    cv::Mat mypix = cv::imread(url.toStdString());
-    m_current_filepath = url;
-
-    // use openCV to open it
-    if (!mypix.empty())
-    {
-       
-        auto pixmap = cv_to_qpixmap_converter(mypix);
-        m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
-        
-        m_current_image = pixmap;
-        qDebug() << "OpenCV used to open the image " << text;
-    }
-
-    else
-    {   // if it fails again just display a warning
-        m_image_display_label->setText("Unknown image format");
-        m_image_info_label->setText("WARNING, unknown format: " + text);// set the info label to show warning + the image name
-        // qDebug() << "Supported image formats:" << QImageReader::supportedImageFormats();
-    }        
-}
-
 void ImageViewer::wheelEvent(QWheelEvent* event)
 {
     if(m_image_display_label->isEnabled()) // wheel events will still trigger even if the widget is disabled
@@ -578,12 +764,14 @@ void ImageViewer::wheelEvent(QWheelEvent* event)
 
         if (delta > 0) // rotating the mouse wheel away from you is considered UP
         {
-            m_current_index = (m_current_index == 0) ? m_file_list_container.size() - 1 : m_current_index - 1;
+            m_navigation_direction = -1;
+
+            m_current_index = (m_current_index == 0) ? m_file_list_model->size() - 1 : m_current_index - 1;
             // if at start wrap to end else just go one down
 
-            m_current_filepath = m_file_list_container[m_current_index];
+            m_current_filepath = m_file_list_model->path(m_current_index);
 
-            m_file_list_widget->setCurrentRow(m_current_index);// set list widget marker to current index
+            m_file_list_view->setCurrentIndex(m_file_list_model->index(m_current_index));// set list marker to current index
 
             clear_modified_image();
 
@@ -591,12 +779,14 @@ void ImageViewer::wheelEvent(QWheelEvent* event)
         }
         else // rotating the mouse wheel towards you is considered DOWN
         {
-            m_current_index = (m_current_index == m_file_list_container.size() - 1) ? 0 : m_current_index + 1;
+            m_navigation_direction = 1;
+
+            m_current_index = (m_current_index == m_file_list_model->size() - 1) ? 0 : m_current_index + 1;
             // if at end go at start else just go one up
 
-            m_current_filepath = m_file_list_container[m_current_index];
+            m_current_filepath = m_file_list_model->path(m_current_index);
 
-            m_file_list_widget->setCurrentRow(m_current_index);// set list widget marker to current index
+            m_file_list_view->setCurrentIndex(m_file_list_model->index(m_current_index));// set list marker to current index
 
             clear_modified_image();
 
@@ -613,75 +803,267 @@ void ImageViewer::wheelEvent(QWheelEvent* event)
 void ImageViewer::load_image(int row)
 {
 
-    auto url = m_file_list_container[row]; // contains the full paths already
+    auto url = m_file_list_model->path(row); // folder plus file name
     //qDebug() << "URL Data: " << url;        
     m_current_filepath = url;
-    QPixmap mypix_qt(url);
 
     reset_image_transforms();
+    m_modification = Modification::none;
 
+    auto file_name = truncate_url_to_image_name(url);
 
-    // check if it's loaded in the QPixmap object
-    if (!mypix_qt.isNull())
-    {
-        m_image_display_label->setPixmap(scale_image_to_fit(mypix_qt));
+    // info for the current image
+    QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
+    m_image_info_label->setText(image_info);
 
-        auto file_name = truncate_url_to_image_name(url);
+    // every request gets a new generation, results for older ones are never shown
+    ++m_load_generation;
 
-        // info for the current image
-        QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
+    // the filter thread's full resolution decode of the previous image isn't needed anymore
+    m_filter_worker->post([this]()
+    {
+        m_decoded_full = QImage();
+    });
 
-        m_image_info_label->setText(image_info);
+    // recently viewed images skip both the decode and the rescale
+    ImageCache::Entry cached;
 
-        // store current image
-        m_current_image = mypix_qt;
+    if (m_image_cache->find(url, cached))
+    {
+        m_image_display_label->setPixmap(cached.display);
+        m_current_image = cached.full;
     }
-       
+
     else
     {
-        handle_image_with_cv(url, url);
+        // decode on the loader's threads, the previous picture stays up until the result arrives
+        m_current_image = QImage();
+        m_image_loader->load(url, m_load_generation);
     }
+
+    schedule_prefetch();
 }
 
-void ImageViewer::on_reset_image_button_pressed()
+void ImageViewer::on_image_loaded(const QString& path, quint64 generation, const QImage& full, const QImage& display)
 {
-    load_image(m_current_index);
-    clear_modified_image();
+    if (display.isNull())
+    {
+        if (generation == m_load_generation)
+        {
+            // neither Qt nor OpenCV could decode it, just display a warning
+            m_image_display_label->setText("Unknown image format");
+            m_image_info_label->setText("WARNING, unknown format: " + truncate_url_to_image_name(path));// set the info label to show warning + the image name
+        }
+
+        return;
+    }
+
+    QPixmap display_pixmap = QPixmap::fromImage(display);
+    m_image_cache->insert(path, full, display_pixmap);
+
+    // the user already moved on, the result is only kept in the cache
+    if (generation != m_load_generation)
+    {
+        return;
+    }
+
+    m_image_display_label->setPixmap(display_pixmap);
+
+    // store current image, unless only the display sized version was decoded
+    // (a filter may already have pulled in the full resolution one meanwhile)
+    if (!full.isNull())
+    {
+        m_current_image = full;
+    }
 }
 
+// everything a filter thread job needs to rebuild the picture, the flips included
+ImageViewer::ImageRequest ImageViewer::image_request(Modification modification) const
+{
+    ImageRequest request;
+    request.current = m_current_image;
+    request.path = m_current_filepath;
+    request.generation = m_load_generation;
+    request.modification = modification;
 
-// FILTERS
-void ImageViewer::on_contour_button_pressed()
-{    
-            
-    cv::Mat pix2contour = cv::imread(m_current_filepath.toStdString());    
-    
-    cv::cvtColor(pix2contour, pix2contour, cv::COLOR_RGB2GRAY); // in place conversion
+    if (m_flipped_horizontally) request.flips.scale(-1, 1);
+    if (m_flipped_vertically) request.flips.scale(1, -1);
 
-    // pre filter blurring to control noise    
-    int kernel_size = m_contour_blur_value % 2 == 0 ? m_contour_blur_value + 1 : m_contour_blur_value;
-    cv::GaussianBlur(pix2contour, pix2contour, cv::Size(kernel_size, kernel_size), 10.0);
+    return request;
+}
 
-    cv::Mat edges;
-    cv::Canny(pix2contour, edges, m_contour_low_threshold, m_contour_high_threshold); //50, 150 default
-    
-    // post filter blur to avoid sharp and pixelated lines
-    cv::GaussianBlur(edges, edges, cv::Size(3, 3), 1.5);
+// GUI thread, keeps a decode from the filter thread unless the user moved to another image
+void ImageViewer::adopt_full_resolution_image(const ImageRequest& request, const QImage& full)
+{
+    if (request.generation != m_load_generation || full.isNull() || !m_current_image.isNull())
+    {
+        return;
+    }
 
-    cv::bitwise_not(edges, edges);// invert
+    m_current_image = full;
+    m_image_cache->attach_full(request.path, full);
+}
 
-    // convert back to pixmap
-    QImage qimage(edges.data, edges.cols, edges.rows, edges.step, QImage::Format_Grayscale8);    
-    QPixmap pixmap = QPixmap::fromImage(qimage);
-    m_modified_image = pixmap;    
+// full resolution pixels for filters, flips and saving, runs on the filter thread
+// display loads may decode at reduced size, so the full image is decoded here on first use
+// and handed to the GUI thread through adopt_full_resolution_image()
+QImage ImageViewer::full_resolution_image(const ImageRequest& request)
+{
+    if (!request.current.isNull())
+    {
+        return request.current;
+    }
 
-    m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
-    
-    m_modified_image = pixmap;   
+    // jobs posted before the GUI adopted the decode reuse it
+    if (m_decoded_generation != request.generation || m_decoded_full.isNull())
+    {
+        m_decoded_full = QImage(); // the previous image's pixels go before the next decode
+        m_decoded_generation = request.generation;
 
-    auto file_name = truncate_url_to_image_name(m_current_filepath);
-    QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
-    m_image_info_label->setText("Contour " + image_info);
+        // mapped again for this decode only, open() checks size and modification time so a file
+        // rewritten since the display load is read as it is now
+        MappedFile::Handle encoded = MappedFile::open(request.path);
+
+        if (encoded)
+        {
+            m_decoded_full = ImageDecoder::decode(request.path, encoded->bytes());
+        }
+    }
+
+    return m_decoded_full;
+}
+
+// runs the filter stack on source, only the stages after a changed one are recomputed
+// a preview runs the same stack on a display sized proxy instead
+const cv::Mat& ImageViewer::filter_result(const QImage& source, bool preview)
+{
+    // the BGR source is made once per image and shared by every filter click after that
+    if (!m_filter_pipeline->has_source(source.cacheKey()))
+    {
+        m_filter_pipeline->set_source(qimage_to_bgr(source), source.cacheKey());
+    }
+
+    if (!preview)
+    {
+        return m_filter_pipeline->result();
+    }
+
+    if (!m_preview_pipeline->has_source(source.cacheKey()))
+    {
+        const cv::Mat& full = m_filter_pipeline->source();
+
+        // proxy no larger than the display area, the kernels shrink with it
+        double scale = qMin(1.0, qMin(static_cast<double>(m_scaled_max_dimension_x) / full.cols, static_cast<double>(m_scaled_max_dimension_y) / full.rows));
+
+        cv::Mat proxy;
+
+        if (scale < 1.0)
+        {
+            cv::resize(full, proxy, cv::Size(), scale, scale, cv::INTER_AREA);
+        }
+        else
+        {
+            proxy = full;
+        }
+
+        m_preview_pipeline->set_source(proxy, source.cacheKey(), static_cast<double>(proxy.cols) / full.cols);
+    }
+
+    return m_preview_pipeline->result();
+}
+
+// the full resolution version of what the request shows, ASCII aside
+// source receives the unmodified image so the caller can hand it to the GUI thread
+QImage ImageViewer::modified_image(const ImageRequest& request, QImage& source)
+{
+    source = full_resolution_image(request);
+
+    if (source.isNull())
+    {
+        return QImage();
+    }
+
+    switch (request.modification)
+    {
+    case Modification::filters:
+        return cv_to_qimage(filter_result(source, false));
+
+    case Modification::flips:
+        return source.transformed(request.flips);
+
+    default:
+        return source;
+    }
+}
+
+// gives the converter the picture a conversion was started on, only when it is a new one, so
+// detail and colour changes reuse the grayscale version the converter keeps
+bool ImageViewer::load_ascii_source(const ImageRequest& request, quint64 input_id)
+{
+    if (m_ascii_source_id == input_id)
+    {
+        return !m_ascii_source.isNull();
+    }
+
+    QImage source;
+    m_ascii_source = modified_image(request, source);
+    m_ascii_source_id = input_id;
+
+    if (m_ascii_source.isNull())
+    {
+        return false;
+    }
+
+    // the view may convert m_ascii_source's format, it then points into the converted copy
+    m_ascii_converter->open_image(qimage_to_cv_view(m_ascii_source));
+
+    return true;
+}
+
+// queue the next few images in the direction the user is moving
+void ImageViewer::schedule_prefetch()
+{
+    QStringList wanted;
+    int count = m_file_list_model->size();
+
+    for (int step = 1; step <= m_prefetch_count && step < count; ++step)
+    {
+        int index = ((m_current_index + step * m_navigation_direction) % count + count) % count; // wraps like the wheel
+
+        QString path = m_file_list_model->path(index);
+
+        if (!m_image_cache->contains(path))
+        {
+            wanted.append(path);
+        }
+    }
+
+    m_image_loader->prefetch(wanted);
+}
+
+void ImageViewer::on_prefetched_image_ready(const QString& path, const QImage& full, const QImage& display)
+{
+    m_image_cache->insert(path, full, QPixmap::fromImage(display));
+}
+
+void ImageViewer::on_reset_image_button_pressed()
+{
+    load_image(m_current_index);
+    clear_modified_image();
+}
+
+
+// FILTERS
+void ImageViewer::on_contour_button_pressed()
+{    
+    FilterPipeline::Step step;
+    step.operation = FilterPipeline::Operation::contour;
+    step.kernel_size = m_contour_blur_value; // pre filter blur
+    step.low_threshold = m_contour_low_threshold; //50, 150 default
+    step.high_threshold = m_contour_high_threshold;
+
+    post_filter_step(*m_filter_worker, m_filter_pipeline.get(), m_preview_pipeline.get(), step);
+    show_filter_result(filter_slider_dragging());
 }
 
 // contour sliders
@@ -708,14 +1090,48 @@ void ImageViewer::get_contour_slider_blur_value()
     on_contour_button_pressed();
 }
 
+// converts on the filter thread, repeated slider values only run the newest one
 void ImageViewer::on_convert_to_ascii_button_pressed()
 {
-    disable_image_controls();
+    // run on whatever is on screen (flipped or filtered), unless that is our own ASCII output
+    // the job rebuilds that picture itself, so nothing in flight has to finish first
+    if (m_modification != Modification::ascii)
+    {
+        m_ascii_request = image_request(m_modification);
+        ++m_ascii_input_id;
+        m_modification = Modification::ascii;
+    }
 
-    auto file_name = truncate_url_to_image_name(m_current_filepath);
-    auto path = m_current_filepath.toStdString();   
+    ImageRequest request = m_ascii_request;
+    quint64 input_id = m_ascii_input_id;
+    ASCIIConverter* converter = m_ascii_converter.get();
+    int detail = m_ascii_detail;
+    bool colored = m_ascii_colored;
 
-    cv::Mat cv_img = m_ascii_converter->process(path, m_ascii_detail, m_ascii_colored);
+    m_filter_worker->post(FilterWorker::Update(), [this, request, input_id, converter, detail, colored]()
+    {
+        if (!load_ascii_source(request, input_id))
+        {
+            return FilterWorker::Show();
+        }
+
+        cv::Mat cv_img = converter->convert(detail, colored);
+
+        return FilterWorker::Show([this, cv_img]() mutable
+        {
+            display_ascii_image(cv_img);
+        });
+    });
+}
+
+void ImageViewer::display_ascii_image(cv::Mat& cv_img)
+{
+    if (cv_img.empty())
+    {
+        return;
+    }
+
+    auto file_name = truncate_url_to_image_name(m_current_filepath);
 
     auto pixmap = cv_to_qpixmap_converter(cv_img);
 
@@ -726,8 +1142,6 @@ void ImageViewer::on_convert_to_ascii_button_pressed()
     // set info
     QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
     m_image_info_label->setText("ASCII " + image_info);    
-
-    enable_image_controls();
 }
 
 void ImageViewer::get_ascii_slider_value()
@@ -742,113 +1156,196 @@ void ImageViewer::get_ascii_slider_value()
 void ImageViewer::get_ascii_color_checkbox_state_changed(bool checked)
 {
     m_ascii_colored = checked;
+
+    // if the ASCII result is on screen it is redrawn, the converter keeps its source
+    if (m_modification == Modification::ascii)
+    {
+        on_convert_to_ascii_button_pressed();
+    }
 }
 
 void ImageViewer::on_convert_to_grayscale_button_pressed()
 {
-    cv::Mat pix2gray = cv::imread(m_current_filepath.toStdString());
-    cv::cvtColor(pix2gray, pix2gray, cv::COLOR_RGB2GRAY); // in place conversion
+    FilterPipeline::Step step;
+    step.operation = FilterPipeline::Operation::grayscale;
 
-    auto pixmap = cv_to_qpixmap_converter(pix2gray);
-    m_modified_image = pixmap;
-
-    m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
-    auto file_name = truncate_url_to_image_name(m_current_filepath);
-    QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
-    m_image_info_label->setText("Grayscale " + image_info);
+    post_filter_step(*m_filter_worker, m_filter_pipeline.get(), m_preview_pipeline.get(), step);
+    show_filter_result(filter_slider_dragging());
 }
 
 void ImageViewer::get_blur_slider_value()
 {
     m_blur_value = m_blur_slider->value();
-    m_blur_label->setText(QString("Blur value: %1").arg(m_blur_value));
+    m_blur_label->setText(QString("Blur sigma: %1").arg(m_blur_value));
 
     blur_image();
 }
 
-void ImageViewer::blur_image()
+void ImageViewer::get_fast_blur_checkbox_state_changed(bool checked)
 {
-    
-    cv::Mat pix2blur = cv::imread(m_current_filepath.toStdString());
+    m_fast_blur = checked;
 
-    // kernel must odd
-    int kernel_size = m_blur_value % 2 == 0 ? m_blur_value + 1 : m_blur_value;
-    cv::GaussianBlur(pix2blur, pix2blur, cv::Size(kernel_size, kernel_size), 12.0);
+    blur_image();
+}
 
-    auto pixmap = cv_to_qpixmap_converter(pix2blur);    
-    m_modified_image = pixmap;
-       
-    m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
+void ImageViewer::blur_image()
+{
+    FilterPipeline::Step step;
+    step.operation = FilterPipeline::Operation::blur;
+    step.sigma = m_blur_value;
+    step.blur_quality = m_fast_blur ? FastBlur::Quality::fast : FastBlur::Quality::accurate;
 
-    auto file_name = truncate_url_to_image_name(m_current_filepath);
-    QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
-    m_image_info_label->setText("Blur " + image_info);
+    post_filter_step(*m_filter_worker, m_filter_pipeline.get(), m_preview_pipeline.get(), step);
+    show_filter_result(filter_slider_dragging());
 }
 
 void ImageViewer::invert_image()
 {
-    cv::Mat pix_input = cv::imread(m_current_filepath.toStdString());
-
-    cv::Mat pix_output;
-    cv::bitwise_not(pix_input, pix_output);
-
-    auto pixmap = cv_to_qpixmap_converter(pix_output);
-    m_modified_image = pixmap;
+    FilterPipeline::Step step;
+    step.operation = FilterPipeline::Operation::invert;
 
-    m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
-
-    auto file_name = truncate_url_to_image_name(m_current_filepath);
-    QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
-    m_image_info_label->setText("Invert " + image_info);
+    post_filter_step(*m_filter_worker, m_filter_pipeline.get(), m_preview_pipeline.get(), step);
+    show_filter_result(filter_slider_dragging());
 }
 
 void ImageViewer::clear_modified_image()
 {
     m_modified_image = QPixmap();
+    m_modification = Modification::none;
+    m_filter_preview_pending = false;
+
+    // back to the unfiltered image, a render still running for the old stack is never shown
+    FilterPipeline* pipeline = m_filter_pipeline.get();
+    FilterPipeline* preview_pipeline = m_preview_pipeline.get();
+
+    m_filter_worker->post([pipeline, preview_pipeline]()
+    {
+        pipeline->clear();
+        preview_pipeline->clear();
+    });
+    m_filter_worker->cancel();
 }
 
+// the picture is rebuilt at full resolution and written on the filter thread: a slider preview
+// on screen is only display sized, and the render of the newest result may not have run yet
 void ImageViewer::save_image()
 {
-    
-
     QString file_path = QFileDialog::getSaveFileName(this, "Save Image", m_source_folder + "/saved_image", "Images (*.png *.jpg *.jpeg *.bmp)");
 
-    if (!file_path.isEmpty()) 
+    if (file_path.isEmpty()) 
     {
-        if (!m_modified_image.isNull())
+        return;
+    }
+
+    ImageRequest request = image_request(m_modification);
+    ImageRequest ascii_request = m_ascii_request;
+    quint64 input_id = m_ascii_input_id;
+    int detail = m_ascii_detail;
+    bool colored = m_ascii_colored;
+
+    // an update rather than a render, a later slider move can't drop it
+    m_filter_worker->post([this, request, ascii_request, input_id, detail, colored, file_path]()
+    {
+        QImage image;
+
+        if (request.modification == Modification::ascii)
         {
-            m_modified_image.save(file_path);
+            if (load_ascii_source(ascii_request, input_id))
+            {
+                image = cv_to_qimage(m_ascii_converter->convert(detail, colored));
+            }
         }
 
         else
         {
-            m_current_image.save(file_path);
+            QImage source;
+            image = modified_image(request, source);
         }
 
-            
-    }
-    
+        if (image.isNull() || !image.save(file_path))
+        {
+            qDebug() << "failed to save the image to" << file_path;
+        }
+    });
 }
 
 
 void ImageViewer::sharpen()
 {
-    cv::Mat sharpened = cv::imread(m_current_filepath.toStdString());
+    FilterPipeline::Step step;
+    step.operation = FilterPipeline::Operation::sharpen;
+    step.sharpen_amount = m_sharpen_value;
 
-    cv::Mat blurred;
-    // make a blurred version of the image
-    cv::GaussianBlur(sharpened, blurred, cv::Size(0, 0), 3);
+    post_filter_step(*m_filter_worker, m_filter_pipeline.get(), m_preview_pipeline.get(), step);
+    show_filter_result(filter_slider_dragging());
+}
 
-    // subtract the blurred image from the original with weights    
-    cv::addWeighted(sharpened, m_sharpen_value, blurred, -(m_sharpen_value - 1), 0, sharpened);
-    auto pixmap = cv_to_qpixmap_converter(sharpened);
-    m_modified_image = pixmap;
+// runs the filter stack on the full resolution image, only the stages after a changed one are recomputed
+// a preview runs the same stack on a display sized proxy instead, m_modified_image keeps the last full result
+// the work happens on the filter thread, a newer request replaces this one if it hasn't started yet
+void ImageViewer::show_filter_result(bool preview)
+{
+    if (m_current_filepath.isEmpty())
+    {
+        return;
+    }
+
+    ImageRequest request = image_request(Modification::filters);
+
+    m_modification = Modification::filters;
+    m_filter_preview_pending = preview;
+
+    m_filter_worker->post(FilterWorker::Update(), [this, request, preview]()
+    {
+        // decoded here when only the display sized image was loaded, the window stays responsive
+        QImage source = full_resolution_image(request);
+
+        if (source.isNull())
+        {
+            return FilterWorker::Show();
+        }
+
+        cv::Mat result = filter_result(source, preview); // shares the node's buffer, the next run allocates a new one
+        QString description = preview ? m_preview_pipeline->description() : m_filter_pipeline->description();
+
+        return FilterWorker::Show([this, request, source, result, description, preview]()
+        {
+            adopt_full_resolution_image(request, source);
+            present_filter_result(result, description, preview);
+        });
+    });
+}
+
+void ImageViewer::present_filter_result(const cv::Mat& result, const QString& description, bool preview)
+{
+    auto pixmap = cv_to_qpixmap_converter(result);
 
+    // a preview is already display sized, scale_image_to_fit leaves it alone
     m_image_display_label->setPixmap(scale_image_to_fit(pixmap));
 
+    if (!preview)
+    {
+        m_modified_image = pixmap;
+    }
+
     auto file_name = truncate_url_to_image_name(m_current_filepath);
     QString image_info = set_info_string(m_current_index + 1, m_number_of_files, file_name);
-    m_image_info_label->setText("Sharpened " + image_info);
+    m_image_info_label->setText(description + (preview ? " (preview) " : " ") + image_info);
+}
+
+// sliders moved with the mouse only get proxy previews until they are let go
+bool ImageViewer::filter_slider_dragging() const
+{
+    return m_contour_slider_A->isSliderDown() || m_contour_slider_B->isSliderDown() || m_contour_slider_blur->isSliderDown()
+        || m_blur_slider->isSliderDown() || m_sharpen_slider->isSliderDown();
+}
+
+void ImageViewer::on_filter_slider_released()
+{
+    if (m_filter_preview_pending)
+    {
+        show_filter_result();
+    }
 }
 
 void ImageViewer::get_sharpen_slider_value()
@@ -876,6 +1373,7 @@ void ImageViewer::disable_image_controls()
     m_contour_slider_B->setEnabled(false);
     m_contour_slider_blur->setEnabled(false);   
     m_blur_slider->setEnabled(false);
+    m_fast_blur_checkbox->setEnabled(false);
     m_sharpen_slider->setEnabled(false);
     m_flip_horizontal_button->setEnabled(false);
     m_flip_vertical_button->setEnabled(false);
@@ -884,7 +1382,7 @@ void ImageViewer::disable_image_controls()
     m_export_ascii_text_button->setEnabled(false);
 
     m_image_display_label->setEnabled(false);
-    m_file_list_widget->setEnabled(false);
+    m_file_list_view->setEnabled(false);
 
 }
 
@@ -903,6 +1401,7 @@ void ImageViewer::enable_image_controls()
     m_contour_slider_B->setEnabled(true);
     m_contour_slider_blur->setEnabled(true);
     m_blur_slider->setEnabled(true);
+    m_fast_blur_checkbox->setEnabled(true);
     m_sharpen_slider->setEnabled(true);
     m_flip_horizontal_button->setEnabled(true);
     m_flip_vertical_button->setEnabled(true);
@@ -911,7 +1410,7 @@ void ImageViewer::enable_image_controls()
     m_export_ascii_text_button->setEnabled(true);
 
     m_image_display_label->setEnabled(true);
-    m_file_list_widget->setEnabled(true);
+    m_file_list_view->setEnabled(true);
 }
 
 void ImageViewer::reset_image_transforms()
@@ -922,78 +1421,58 @@ void ImageViewer::reset_image_transforms()
 
 void ImageViewer::flip_horizontal()
 {    
-
-    if (m_current_image.isNull())
-    {
-        qDebug() << "failed to open image from flip horizontal method";
-        return;
-    }
-
-    if (!m_flipped_horizontally)
-    {       
-        m_flipped_horizontally = true;
-        apply_all_transforms();
-    }
-
-    else
-    {
-        m_flipped_horizontally = false;
-        apply_all_transforms();
-    }
+    m_flipped_horizontally = !m_flipped_horizontally;
+    apply_all_transforms();
 }
 
 void ImageViewer::flip_verical()
 {
-
-
-    if (m_current_image.isNull())
-    {
-        qDebug() << "failed to open image from flip vertical method";
-        return;
-    }
-
-    if (!m_flipped_vertically)
-    {
-        m_flipped_vertically = true;
-        apply_all_transforms();
-    }
-
-    else
-    {
-        m_flipped_vertically = false;
-        apply_all_transforms();
-    }
-
+    m_flipped_vertically = !m_flipped_vertically;
+    apply_all_transforms();
 }
 
+// flips the full resolution image on the filter thread, it may have to be decoded first
 void ImageViewer::apply_all_transforms()
 {
+    ImageRequest request = image_request(Modification::flips);
 
-    QTransform transform;
-    
-    if (m_flipped_horizontally) transform.scale(-1, 1);
-    if (m_flipped_vertically) transform.scale(1, -1);
+    m_modification = Modification::flips;
+    m_filter_worker->cancel(); // a filter render still running would replace the flipped image
 
+    m_filter_worker->post(FilterWorker::Update(), [this, request]()
+    {
+        QImage source;
+        QImage flipped = modified_image(request, source);
 
-    auto flipped = m_current_image.transformed(transform);
+        if (flipped.isNull())
+        {
+            return FilterWorker::Show([]()
+            {
+                qDebug() << "failed to open image for the flip";
+            });
+        }
 
-    m_modified_image = flipped;
-    m_image_display_label->setPixmap(scale_image_to_fit(flipped));
+        return FilterWorker::Show([this, request, source, flipped]()
+        {
+            adopt_full_resolution_image(request, source);
 
+            m_modified_image = QPixmap::fromImage(flipped);
+            m_image_display_label->setPixmap(scale_image_to_fit(m_modified_image));
+        });
+    });
 }
 
-void ImageViewer::on_list_widget_item_clicked(QListWidgetItem* item)
+void ImageViewer::on_list_widget_item_clicked(const QModelIndex& index)
 {
     clear_modified_image();
 
-    if(!item)
+    if(!index.isValid())
     {
         return;
     }
 
-    QString file_name = item->text();
-    QDir dir(m_source_folder);
-    QString full_path = dir.absoluteFilePath(file_name); 
+    QString file_name = m_file_list_model->file_name(index.row());
+    QString full_path = m_file_list_model->path(index.row()); 
 
 
     auto os = QOperatingSystemVersion::current();
@@ -1045,15 +1524,32 @@ void ImageViewer::on_get_random_image_button_pressed()
 
 void ImageViewer::on_export_ascii_text_button_pressed()
 {    
-    on_convert_to_ascii_button_pressed();
+    on_convert_to_ascii_button_pressed(); // shows what the text is written from
 
     QString directory = QFileDialog::getSaveFileName(this, "Save the ASCII art", m_source_folder + "/ascii_art.txt");
 
     if (!directory.isEmpty())
     {        
-        m_ascii_converter->output_text(m_current_filepath.toStdString(), directory.toStdString());
+        ImageRequest request = m_ascii_request;
+        quint64 input_id = m_ascii_input_id;
+        ASCIIConverter* converter = m_ascii_converter.get();
+        int detail = m_ascii_detail;
+
+        // written on the filter thread, after the conversion above, the converter is never shared
+        m_filter_worker->post([this, request, input_id, converter, detail, directory]()
+        {
+            if (!load_ascii_source(request, input_id))
+            {
+                return;
+            }
+
+            converter->set_width(detail);
+            converter->resize_image();
+            converter->ascii_conversion();
+            converter->write_to_file(directory.toStdString());
+        });
     }
 
     //m_export_ascii_text_button->setEnabled(false);
 
-}
\ No newline at end of file
+}
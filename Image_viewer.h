@@ -2,20 +2,31 @@
 
 #include <QtWidgets/QMainWindow>
 #include <QPushButton>
+#include <QImage>
+#include <QTransform>
 
 class QVBoxLayout;
-class QListWidget;
+class QListView;
+class QModelIndex;
+class QFileSystemWatcher;
+class QTimer;
 class QPushButton;
 class QLabel;
 class QHBoxLayout;
-class QListWidgetItem;
 class QSlider;
 class QCheckBox;
 
 class ASCIIConverter;
+class FilterPipeline;
+class FilterWorker;
+class ImageCache;
+class ImageLoader;
+class ThumbnailStore;
+class ImageListModel;
+class DirectoryScanner;
 class QPixmap;
 class QImage;
-class Mat;
+namespace cv { class Mat; }
 
 
 class ImageViewer : public QMainWindow
@@ -37,14 +48,14 @@ public:
 
     void check_settings();
 
-    void display_clicked_image(QListWidgetItem* list_object);
-
-    void handle_image_with_cv(const QString& url, const QString& text);
+    void display_clicked_image(const QModelIndex& index);
 
     void wheelEvent(QWheelEvent* event) override;
 
     void load_image(int row);
 
+    void schedule_prefetch();
+
     // filters
     void on_contour_button_pressed();
 
@@ -52,6 +63,8 @@ public:
 
     void on_convert_to_ascii_button_pressed();
 
+    void display_ascii_image(cv::Mat& cv_img);
+
     void get_ascii_slider_value();
 
     void get_ascii_color_checkbox_state_changed(bool checked);
@@ -70,6 +83,14 @@ public:
 
     void sharpen();
 
+    void show_filter_result(bool preview = false);
+
+    void present_filter_result(const cv::Mat& result, const QString& description, bool preview);
+
+    bool filter_slider_dragging() const;
+
+    void on_filter_slider_released();
+
     void get_sharpen_slider_value();
 
     void disable_image_controls();
@@ -94,23 +115,81 @@ public:
 
     void get_contour_slider_blur_value();
 
-    void get_blur_slider_value();   
+    void get_blur_slider_value();
+
+    void get_fast_blur_checkbox_state_changed(bool checked);   
 
     ~ImageViewer();
 
 private slots:
-    void on_list_widget_item_clicked(QListWidgetItem* item);
+    void on_list_widget_item_clicked(const QModelIndex& index);
+
+    void on_files_found(quint64 generation, const QStringList& names);
+
+    void on_scan_finished(quint64 generation, const QStringList& sorted_names);
+
+    void refresh_folder();
+
+    void on_recursive_checkbox_toggled(bool checked);
+
+    void on_image_loaded(const QString& path, quint64 generation, const QImage& full, const QImage& display);
+
+    void on_prefetched_image_ready(const QString& path, const QImage& full, const QImage& display);
 
 private:
+    // what the picture on screen is made of, recorded when the request is posted so a filter
+    // thread job can rebuild it even when the render that would have shown it was superseded
+    enum class Modification
+    {
+        none,
+        filters,
+        flips,
+        ascii
+    };
+
+    // GUI state a filter thread job works from, copied when the job is posted
+    struct ImageRequest
+    {
+        QImage current; // m_current_image, null until the full resolution image is decoded
+        QString path;
+        quint64 generation = 0;
+        Modification modification = Modification::none;
+        QTransform flips;
+    };
+
+    ImageRequest image_request(Modification modification) const;
+
+    void adopt_full_resolution_image(const ImageRequest& request, const QImage& full);
+
+    // filter thread only
+    QImage full_resolution_image(const ImageRequest& request);
+
+    const cv::Mat& filter_result(const QImage& source, bool preview);
+
+    QImage modified_image(const ImageRequest& request, QImage& source);
+
+    bool load_ascii_source(const ImageRequest& request, quint64 input_id);
+
     QString m_source_folder;
     QString m_destination_folder;
     QString m_current_filepath;
     QString m_settings_file;
-    QStringList m_file_list_container;
-
-    QPixmap m_current_image;
+    ImageListModel* m_file_list_model; // paths of the current folder, filled while the folder is scanned
+    DirectoryScanner* m_directory_scanner;
+    quint64 m_scan_generation = 0; // bumped per listing, batches of an abandoned scan are dropped
+    bool m_scan_running = false;
+    bool m_refresh_pending = false; // the folder changed while a scan was running
+    QFileSystemWatcher* m_folder_watcher; // m_source_folder, changes are applied to the list incrementally
+    QTimer* m_folder_refresh_timer; // coalesces bursts of change notifications
+
+    QImage m_current_image; // full resolution, null until needed when only a display sized decode was done
     QPixmap m_modified_image;
     //QImage m_working_image;
+    Modification m_modification = Modification::none;
+    ImageRequest m_ascii_request; // what the ASCII conversion on screen was started on
+    quint64 m_ascii_input_id = 0; // bumped with every new m_ascii_request
+    QImage m_ascii_source; // filter thread only, input of the last ASCII conversion, the converter's view points into it
+    quint64 m_ascii_source_id = 0; // filter thread only, m_ascii_input_id m_ascii_source was made for
 
     int m_scaled_max_dimension_y;
     int m_scaled_max_dimension_x;
@@ -119,12 +198,26 @@ private:
 
     //ImageConverter* m_ascii_converter;
     std::unique_ptr<ASCIIConverter> m_ascii_converter;
+    std::unique_ptr<FilterPipeline> m_filter_pipeline; // stacked filters on the current image, each stage cached
+    std::unique_ptr<FilterPipeline> m_preview_pipeline; // same stack on a display sized proxy, used while a slider is dragged
+    bool m_filter_preview_pending = false; // the newest filter request is a proxy preview, the full result is not computed yet
+    QImage m_decoded_full; // filter thread only, full resolution decode of the image of m_decoded_generation
+    quint64 m_decoded_generation = 0;
+    std::unique_ptr<FilterWorker> m_filter_worker; // runs the filters and ASCII conversions, declared after what its jobs use
+
+    std::unique_ptr<ImageCache> m_image_cache; // recently viewed images, full and display sized
+    std::unique_ptr<ImageLoader> m_image_loader; // decodes the requested image and the next ones in the scroll direction
+    quint64 m_load_generation = 0; // bumped on every navigation, stale decode results are dropped
+    int m_navigation_direction = 1; // +1 scrolling down the list, -1 scrolling up
+    int m_prefetch_count = 3;
+    std::unique_ptr<ThumbnailStore> m_thumbnail_store; // persistent list icons, one pack file per folder
     
     //file list layout    
     QVBoxLayout* m_file_layout;
-    QListWidget* m_file_list_widget; // the visible QListWidget list on the right
+    QListView* m_file_list_view; // the visible file list on the left
     QPushButton* m_open_folder_button;
     QPushButton* m_rescan_folder_button;
+    QCheckBox* m_recursive_checkbox; // list the images of all subfolders too
     QHBoxLayout* m_file_buttons_layout;
     // image display layout
     QVBoxLayout* m_image_layout;
@@ -166,7 +259,9 @@ private:
 
     QLabel* m_blur_label;
     QSlider* m_blur_slider;
-    int m_blur_value = 3;
+    int m_blur_value = 3; // sigma
+    QCheckBox* m_fast_blur_checkbox;
+    bool m_fast_blur = false;
 
     QLabel* m_sharpen_label;
     QSlider* m_sharpen_slider;
@@ -1,5 +1,8 @@
 ﻿#include "ascii_converter.h"
+#include "mapped_file.h"
 #include <fstream>
+#include <cstring>
+#include <filesystem>
 #include <QDebug>
 
 using std::vector;
@@ -17,18 +20,71 @@ using cv::Mat;
 ASCIIConverter::ASCIIConverter(int width) :m_width(width)
 {
 	this->m_default_font = m_default_font_name;
+
+	// precompute the symbol for every possible luminance value
+	const int charset_size = sizeof(charset);
+	m_charset_lut.create(1, 256, CV_8UC1);
+
+	for (int value = 0; value < 256; ++value)
+	{
+		int current_char = min(value / scale_factor, charset_size - 1);
+		m_charset_lut.at<uchar>(0, value) = static_cast<uchar>(charset[current_char]);
+	}
+}
+
+// cache key for a file on disk, changes whenever the file is rewritten
+static string file_cache_key(const string& path)
+{
+	std::error_code error;
+	auto modified = std::filesystem::last_write_time(path, error);
+
+	if (error)
+	{
+		return string();
+	}
+
+	return path + "|" + std::to_string(modified.time_since_epoch().count());
 }
 
 Mat ASCIIConverter::process(const string& path, const int width, bool color)
 {   
+	string key = file_cache_key(path);
+
+	// decode and convert to grayscale only when the file is new or has changed
+	if (key.empty() || key != m_source_key)
+	{
+		open_image(path);
+		m_source_key = m_source.empty() ? string() : key;
+	}
+
+	return convert(width, color);
+}
+
+Mat ASCIIConverter::process(const Mat& image, const int width, bool color, uint64_t image_id)
+{
+	string key = image_id != 0 ? "memory|" + std::to_string(image_id) : string();
+
+	if (key.empty() || key != m_source_key)
+	{
+		open_image(image);
+		m_source_key = m_source.empty() ? string() : key;
+	}
+
+	return convert(width, color);
+}
+
+// runs the stages that depend on the detail and color settings, the source stays cached
+Mat ASCIIConverter::convert(const int width, bool color)
+{
 	this->m_width = width;
 	this->m_colorize_output_image = color; // set color on or off 
-	// clean the buffers!	
-	m_pixel_data.clear();
-	m_new_pixel_data.clear();
-	m_ascii_layout.clear();// CRITICAL
+	// the symbol grid is overwritten in place by ascii_conversion, no clearing needed
+
+	if (m_source.empty())
+	{
+		return Mat();
+	}
 
-	open_image(path);
 	resize_image();
 	ascii_conversion();	
 	get_ascii_image_dimensions();
@@ -36,15 +92,39 @@ Mat ASCIIConverter::process(const string& path, const int width, bool color)
 	return  create_ascii_image();	
 }
 
-void ASCIIConverter::output_text(const string& src_path, const string& dest_path)
+Mat ASCIIConverter::render(bool color, bool transparent)
 {
-	if (m_ascii_layout.empty())
+	if (m_ascii_grid.empty())
 	{
-		m_pixel_data.clear();
-		m_new_pixel_data.clear();
-		m_ascii_layout.clear();
+		return Mat();
+	}
+
+	this->m_colorize_output_image = color;
+
+	return create_ascii_image(transparent);
+}
 
+void ASCIIConverter::output_text(const string& src_path, const string& dest_path)
+{
+	if (m_ascii_grid.empty())
+	{
 		open_image(src_path);
+	}
+
+	output_text(m_source, dest_path);
+}
+
+void ASCIIConverter::output_text(const Mat& image, const string& dest_path)
+{
+	if (m_ascii_grid.empty())
+	{
+		open_image(image);
+
+		if (m_source.empty())
+		{
+			return;
+		}
+
 		resize_image();
 		ascii_conversion();
 	}
@@ -52,40 +132,92 @@ void ASCIIConverter::output_text(const string& src_path, const string& dest_path
 	write_to_file(dest_path);
 }
 
-void ASCIIConverter::open_image(const string& img_path)
+// decoded from the shared mapping, a file the viewer already has open costs no extra I/O
+// MappedFile::open refuses files that are too large and remaps files changed on disk
+Mat ASCIIConverter::read_image(const string& img_path)
 {
-	
+	MappedFile::Handle file = MappedFile::open(QString::fromStdString(img_path));
 
-	bgr_image = cv::imread(img_path);
+	if (!file)
+	{
+		return Mat();
+	}
 
-	
+	Mat encoded(1, static_cast<int>(file->size()), CV_8UC1, const_cast<uchar*>(file->data()));
+
+	return cv::imdecode(encoded, cv::IMREAD_COLOR);
+}
+
+// decodes and makes the grayscale version, everything the later stages need from the file
+void ASCIIConverter::open_image(const string& img_path)
+{
+	Mat decoded = read_image(img_path);
 
-	qDebug() << "Image path from ASCII converter: " << img_path;
+	if (m_verbose)
+	{
+		qDebug() << "Image path from ASCII converter: " << img_path;
+	}
 
-	if (bgr_image.empty())
+	if (decoded.empty())
 	{
+		m_source_key.clear();
+		m_source.release();
 		std::cerr << "File error: could not open " << img_path << std::endl;
 		return;
 	}
 
-	//std::cout << "Image loaded successfully: " << img_path << std::endl;
-	cv::cvtColor(bgr_image, m_image, cv::COLOR_BGR2GRAY);
-	//std::cout << "Image converted successfully: " << img_path << std::endl;
+	open_image(decoded); // the converter holds the only reference to the decoded pixels
+}
+
+void ASCIIConverter::open_image(const Mat& image)
+{
+	// keep a reference only, the caller's pixels are never copied or modified
+	m_source_key.clear();
+	m_source = image;
+
+	if (m_source.empty())
+	{
+		std::cerr << "Image error: empty input image" << std::endl;
+		return;
+	}
+
+	switch (m_source.channels())
+	{
+	case 1:
+		m_source_gray = m_source;
+		break;
+	case 4:
+		cv::cvtColor(m_source, m_source_gray, cv::COLOR_BGRA2GRAY);
+		break;
+	default:
+		cv::cvtColor(m_source, m_source_gray, cv::COLOR_BGR2GRAY);
+		break;
+	}
 }
 
 
 void ASCIIConverter::resize_image()
 {
 	// calculate the aspect ratio of the image
-	float aspect_ratio = static_cast<float>(m_image.rows) / m_image.cols;// use float cast otherwise ratio is truncated
+	float aspect_ratio = static_cast<float>(m_source_gray.rows) / m_source_gray.cols;// use float cast otherwise ratio is truncated
 	//calculate the new image's new height
 	m_new_height = static_cast<int>(aspect_ratio * m_width * ADJUSTED_RATIO);
 	// copy into "m_original_image" member later to get the colors - for later
 	
 	// resize the current m_image to be ready for processing
-	cv::resize(m_image, m_image, cv::Size(m_width, m_new_height), cv::INTER_LINEAR);
+	cv::resize(m_source_gray, m_image, cv::Size(m_width, m_new_height), cv::INTER_LINEAR);
 
-	cv::resize(bgr_image, bgr_image, cv::Size(m_width, m_new_height), cv::INTER_LINEAR);
+	cv::resize(m_source, bgr_image, cv::Size(m_width, m_new_height), cv::INTER_LINEAR);
+
+	// colors are only needed at the output size, so normalize the channel layout after shrinking
+	if (bgr_image.channels() == 4)
+	{
+		cv::cvtColor(bgr_image, bgr_image, cv::COLOR_BGRA2BGR);
+	}
+	else if (bgr_image.channels() == 1)
+	{
+		cv::cvtColor(bgr_image, bgr_image, cv::COLOR_GRAY2BGR);
+	}
 
 	/*std::cout << "After resize: " << m_image.cols << " x " << m_image.rows << std::endl;
 	std::cout << "m_width: " << m_width << "  m_new_height: " << m_new_height << std::endl;*/
@@ -93,150 +225,221 @@ void ASCIIConverter::resize_image()
 }
 
 
-Mat ASCIIConverter::create_ascii_image()
+Mat ASCIIConverter::create_ascii_image(bool transparent)
+{
+	Mat ascii_rebuilt;
+	create_ascii_image(ascii_rebuilt, transparent);
+
+	return ascii_rebuilt;
+}
+
+// renders into a caller owned canvas, the buffer is only reallocated when the output size changes
+void ASCIIConverter::create_ascii_image(Mat& ascii_rebuilt, bool transparent)
 {
-	Mat ascii_rebuilt(m_ascii_image_height, m_ascii_image_width, CV_8UC3, Scalar(255, 255, 255));
+	// white paper, or fully transparent when the glyphs should carry their own alpha
+	if (transparent)
+	{
+		ascii_rebuilt.create(m_ascii_image_height, m_ascii_image_width, CV_8UC4);
+		ascii_rebuilt.setTo(Scalar(0, 0, 0, 0));
+	}
+	else
+	{
+		ascii_rebuilt.create(m_ascii_image_height, m_ascii_image_width, CV_8UC3);
+		ascii_rebuilt.setTo(Scalar(255, 255, 255));
+	}
 
-	int len = m_ascii_layout.size();
+	// rasterize the charset only when the font settings change
+	if (!m_glyph_atlas.matches(GLYPH_FONT_FACE, GLYPH_FONT_SCALE, GLYPH_THICKNESS))
+	{
+		m_glyph_atlas.build(charset, sizeof(charset), GLYPH_FONT_FACE, GLYPH_FONT_SCALE, GLYPH_THICKNESS);
+	}
+
+	const int bands = min(get_worker_count(), ascii_rebuilt.rows);
+
+	if (bands <= 1)
+	{
+		render_rows(ascii_rebuilt, 0, ascii_rebuilt.rows);
+		return;
+	}
+
+	// split the canvas into horizontal pixel bands, every band owns its rows exclusively
+	// one stripe per band, so no more than `bands` of OpenCV's threads work on this render
+	// (the pool itself is process wide and left alone)
+	cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range)
+	{
+		for (int band = range.start; band < range.end; ++band)
+		{
+			int row_begin = static_cast<int>(static_cast<int64_t>(ascii_rebuilt.rows) * band / bands);
+			int row_end = static_cast<int>(static_cast<int64_t>(ascii_rebuilt.rows) * (band + 1) / bands);
+
+			render_rows(ascii_rebuilt, row_begin, row_end);
+		}
+	}, bands);
+}
+
+// draws every glyph that reaches into canvas rows [row_begin, row_end)
+// glyphs are visited in the same row major order for every band, so overlapping
+// antialiased edges blend exactly like a single threaded pass
+void ASCIIConverter::render_rows(Mat& canvas, int row_begin, int row_end)
+{
+	int len = m_ascii_grid.rows;
 
 	int vertical_fudge = 25; // corrects letter offset on top
 
-	// iterate through the ascii layout vector
+	const cv::Vec3b black(0, 0, 0);
+
+	// iterate through the ascii layout grid
 	for (int y = 0; y < len; ++y)
 	{
-		string line = m_ascii_layout[y];
+		int origin_y = static_cast<int>(y * m_font_height * CHAR_ASPECT_RATIO + vertical_fudge);
 
-		for (int x = 0; x < line.length(); ++x)
-		{   
-
-			cv::Point text_position(x * m_font_width, y * m_font_height * CHAR_ASPECT_RATIO + vertical_fudge);	
+		// skip text rows whose glyphs can't touch this band
+		if (origin_y + m_glyph_atlas.bottom() <= row_begin || origin_y + m_glyph_atlas.top() >= row_end)
+		{
+			continue;
+		}
 
-			cv::Scalar current_pixel_color(m_pixel_color_data[y * m_width + x][0], m_pixel_color_data[y * m_width + x][1], m_pixel_color_data[y * m_width + x][2]);// BGR format
+		const char* line = m_ascii_grid.ptr<char>(y);
+		const cv::Vec3b* line_colors = bgr_image.ptr<cv::Vec3b>(y); // resized source, same layout as the grid
 
+		for (int x = 0; x < m_ascii_grid.cols; ++x)
+		{   
+			cv::Point text_position(x * m_font_width, origin_y);	
 
-			// putText(image, text, point, fontFace, fontScale, color, thickness, lineType, bottomLeftOrigin)
+			// blend the pre-rendered glyph instead of calling putText per character
 			if (m_colorize_output_image)
 			{
-				cv::putText(ascii_rebuilt, string(1, line[x]), text_position, cv::FONT_HERSHEY_DUPLEX, 1.0, current_pixel_color, 2, 16, false); // string(1, line[x]) is an rvalue string with length of 1
+				m_glyph_atlas.draw(canvas, line[x], text_position, line_colors[x], row_begin, row_end); // BGR format
 			}
 			else
 			{
-				cv::putText(ascii_rebuilt, string(1, line[x]), text_position, cv::FONT_HERSHEY_DUPLEX, 1.0, Scalar(0, 0, 0), 2, 16, false);
+				m_glyph_atlas.draw(canvas, line[x], text_position, black, row_begin, row_end);
 			}
-			
 		}
-	}	
-
-	return ascii_rebuilt;
+	}
 }
 
-
-void ASCIIConverter::save_image(const Mat& image_to_save)
+void ASCIIConverter::set_width(int width)
 {
-	cv::imwrite("ascii_converted_image.png", image_to_save);
+	m_width = width;
 }
 
-
-// for grayscale 
-// m_pixel_data = m_image.ptr<uchar>(); 
-
-void ASCIIConverter::ascii_conversion()
+void ASCIIConverter::set_colorize(bool color)
 {
-	// clear containers
-	m_pixel_data.clear();
-	m_new_pixel_data.clear();
-	m_pixel_color_data.clear();// color container
+	m_colorize_output_image = color;
+}
 
-	// performance optimization
-	m_pixel_data.reserve(m_image.total());
-	m_new_pixel_data.reserve(m_image.total());
-	m_ascii_layout.reserve(m_image.rows);
+void ASCIIConverter::set_verbose(bool verbose)
+{
+	m_verbose = verbose;
+}
 
-	const int charset_size = sizeof(charset);
-	
-	// standard raster scan based on rows and columns
-	for (int row = 0; row < m_image.size().height; ++row)
-	{
-		for (int col = 0; col < m_image.size().width; ++col)
-		{
-			m_pixel_data.push_back(m_image.at<uchar>(row, col)); 
+bool ASCIIConverter::has_source() const
+{
+	return !m_source.empty();
+}
 
-			m_pixel_color_data.push_back(bgr_image.at<cv::Vec3b>(row, col));
-		}
+void ASCIIConverter::set_worker_count(int workers)
+{
+	m_worker_count = std::max(0, workers);
+}
 
-	}
-	// replace the image values with correct character from the set
-	for (int index = 0; index < m_pixel_data.size(); ++index)
-	{
-		auto pixel = m_pixel_data[index];
-		int current_char = pixel / scale_factor;
+int ASCIIConverter::get_worker_count() const
+{
+	return m_worker_count > 0 ? m_worker_count : cv::getNumberOfCPUs();
+}
 
-		if (int(current_char) >= charset_size)
-		{
-			m_new_pixel_data.push_back(charset[charset_size - 1]);
-		}
 
-		else
-		{
-			m_new_pixel_data.push_back(charset[current_char]);
-		}
-		
-	}
-	// create a vector of strings and reconstruct the image row by row
-	
-	int new_data_limit = m_new_pixel_data.size();
+void ASCIIConverter::save_image(const Mat& image_to_save, const string& dest_path)
+{
+	cv::imwrite(dest_path, image_to_save);
+}
 
-	for (int i = 0; i < new_data_limit; i += m_width)
-	{		
-		string line;
 
-		for (int j = i; j < min(i + m_width, new_data_limit); ++j)// clamped value in case of uneven number of pixels
-		{				
-			line += m_new_pixel_data[j];				
-		}
+void ASCIIConverter::ascii_conversion()
+{
+	// one table lookup per pixel straight from the resized image into the symbol grid
+	// cv::LUT is vectorized and writes into the reused grid buffer
+	cv::LUT(m_image, m_charset_lut, m_ascii_grid);
 
-		m_ascii_layout.push_back(line);			
+	if (!m_verbose)
+	{
+		return;
 	}
 
-
 	std::cout << "Original image: "
 		<< "columns: " << m_image.cols << " x " << " rows: " << m_image.rows << std::endl;
 
 	std::cout << "ASCII layout: "
-		<< "resulting columns: " << m_width << " x " << "resulting rows: " << m_ascii_layout.size() << std::endl;
+		<< "resulting columns: " << m_ascii_grid.cols << " x " << "resulting rows: " << m_ascii_grid.rows << std::endl;
 
 
 }
 
-void ASCIIConverter::write_to_file(const string& dest_path)
+bool ASCIIConverter::write_to_file(const string& dest_path)
 {
 	ofstream file;
+	file.rdbuf()->pubsetbuf(nullptr, 0); // unbuffered, every write below goes straight to the OS
 	file.open(dest_path);
 
 	if (!file.is_open())
 	{
-		cerr << "Error loading the file.";
-		return;
+		cerr << "Error opening the file: " << dest_path << endl;
+		return false;
 	}
 
-	if (!m_ascii_layout.empty())
+	write_to_stream(file);
+	file.close(); // a failing close (full disk) counts as a failed write too
+
+	if (!file)
 	{
+		cerr << "Error writing the file: " << dest_path << endl;
+		return false;
+	}
 
-		int new_data_limit = m_ascii_layout.size(); 
+	return true;
+}
 
-		for (int i = 0; i < new_data_limit; ++i)
-		{
+void ASCIIConverter::write_to_stream(std::ostream& out)
+{
+	if (m_ascii_grid.empty())
+	{
+		return;
+	}
 
-			file << m_ascii_layout[i] << endl;
+	const int rows = m_ascii_grid.rows;
+	const int cols = m_ascii_grid.cols;
+	const size_t line_length = cols + 1; // symbols plus the line break
 
-		}
+	// whole grid in one write by default, bounded chunks of whole lines in streaming mode
+	int lines_per_write = rows;
+
+	if (m_text_chunk_size > 0)
+	{
+		lines_per_write = static_cast<int>(min<size_t>(rows, std::max<size_t>(1, m_text_chunk_size / line_length)));
 	}
 
-	else
+	m_text_buffer.resize(line_length * lines_per_write);
+
+	for (int first = 0; first < rows; first += lines_per_write)
 	{
-		return;
+		int last = min(rows, first + lines_per_write);
+		char* out_line = m_text_buffer.data();
+
+		for (int row = first; row < last; ++row)
+		{
+			std::memcpy(out_line, m_ascii_grid.ptr<char>(row), cols);
+			out_line[cols] = '\n';
+			out_line += line_length;
+		}
+
+		out.write(m_text_buffer.data(), out_line - m_text_buffer.data());
 	}
+}
 
+void ASCIIConverter::set_text_chunk_size(size_t bytes)
+{
+	m_text_chunk_size = bytes;
 }
 
 void ASCIIConverter::get_ascii_image_dimensions()
@@ -261,31 +464,42 @@ Size ASCIIConverter::get_text_size(const string& text, int font_face, double fon
 }
 
 // saves png with opacity
-void ASCIIConverter::save_image_with_opacity(const Mat& image)
+void ASCIIConverter::save_image_with_opacity(const Mat& image, const string& dest_path)
 {
-	// make another Mat image and copy original into it while also adding an alpha channel
-	cv::Mat bgra_image;
-	cv::cvtColor(image, bgra_image, cv::COLOR_BGR2BGRA);
 	int opactity_limit = 245;
 
-
-	// run through the 2D array
-	for (int y = 0; y < bgra_image.rows; ++y)
+	if (image.empty() || image.depth() != CV_8U)
 	{
-		for (int x = 0; x < bgra_image.cols; ++x) 
-		{
-			// create Vec4b reference
-			Vec4b& pixel = bgra_image.at<Vec4b>(y, x);
+		cerr << "Image error: transparent output needs an 8 bit image" << endl;
+		return;
+	}
 
-			// filter the pixel values - set alpha value to 0 for every pixel where value is above threshold
-			if (pixel[0] > opactity_limit && pixel[1] > opactity_limit && pixel[2] > opactity_limit)
-			{
-				// alpha channel 
-				pixel[3] = 0; // set alpha to 0
-			}
-		}
+	// the mask and the channel shuffle below work on BGR, gray and BGRA canvases are converted first
+	cv::Mat bgr = image;
+
+	if (image.channels() == 4)
+	{
+		cv::cvtColor(image, bgr, cv::COLOR_BGRA2BGR);
 	}
+	else if (image.channels() == 1)
+	{
+		cv::cvtColor(image, bgr, cv::COLOR_GRAY2BGR);
+	}
+
+	// background mask: every channel above the threshold, computed with vectorized range check
+	cv::Mat background;
+	cv::inRange(bgr, Scalar(opactity_limit + 1, opactity_limit + 1, opactity_limit + 1), Scalar(255, 255, 255), background);
+
+	// alpha is 0 on the background and opaque everywhere else
+	cv::Mat alpha;
+	cv::bitwise_not(background, alpha);
+
+	// assemble BGRA in a single pass instead of converting first and patching pixels afterwards
+	cv::Mat bgra_image(bgr.size(), CV_8UC4);
+	cv::Mat sources[] = { bgr, alpha };
+	int from_to[] = { 0, 0, 1, 1, 2, 2, 3, 3 };
+	cv::mixChannels(sources, 2, &bgra_image, 1, from_to, 4);
 
-	cv::imwrite("ascii_art_transparent.png", bgra_image);
+	cv::imwrite(dest_path, bgra_image);
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include "glyph_atlas.h"
 using std::string;
 
 class ASCIIConverter
@@ -9,13 +10,22 @@ private:
 	int m_width;
 	float ADJUSTED_RATIO = 0.5;
 	float CHAR_ASPECT_RATIO = 1.5;
+	int GLYPH_FONT_FACE = cv::FONT_HERSHEY_DUPLEX; // font used to draw the symbols
+	double GLYPH_FONT_SCALE = 1.0;
+	int GLYPH_THICKNESS = 2;
 	string m_default_font_name = "DejaVuSansMono.ttf"; //default font to use
 	string m_default_font;
 
+	cv::Mat m_source; // full size input, either decoded here or a view of the caller's image
+	cv::Mat m_source_gray; // full size luminance of m_source
+	string m_source_key; // identity of the cached source (path + mtime or caller id), empty = not reusable
 	cv::Mat m_image;
 	cv::Mat bgr_image;
 
 	bool m_colorize_output_image;
+	bool m_verbose = true; // per image console output
+
+	int m_worker_count = 0; // row bands rendered in parallel, at most this many threads, 0 = one per core
 
 	int m_ascii_image_height;
 	int m_ascii_image_width;
@@ -24,10 +34,13 @@ private:
 
 	int m_new_height;
 
-	std::vector<uchar> m_pixel_data;
-	std::vector<uchar> m_new_pixel_data;
-	std::vector<cv::Vec3b> m_pixel_color_data;
-	std::vector<string> m_ascii_layout;
+	cv::Mat m_charset_lut; // 1 x 256 table, luminance -> charset symbol
+	cv::Mat m_ascii_grid; // CV_8UC1, one symbol per cell, rows are the output lines
+
+	std::vector<char> m_text_buffer; // reused staging buffer for the text export
+	size_t m_text_chunk_size = 0; // bytes per write when streaming, 0 = whole grid in one write
+
+	GlyphAtlas m_glyph_atlas; // charset rendered once, reused for every output image
 
 	static constexpr char charset[21] = { '@', '#', '8', '&', 'W', 'M', 'B', 'Q', 'H', 'D',
 									'X', 'Y', 'O', 'C', 'I', '*', '!', ';', ':', '_', '.' };// 21 symbols charset
@@ -36,22 +49,46 @@ private:
 
 public:
 	cv::Mat process(const string& path, const int width, bool color = false);
+	// in-memory input, 1 (gray), 3 (BGR) or 4 (BGRA) channel 8-bit images are used without copying
+	// a non zero image_id lets repeated calls with the same image skip the grayscale conversion
+	cv::Mat process(const cv::Mat& image, const int width, bool color = false, uint64_t image_id = 0);
+	// redraws the last conversion only, used when just the color mode changes
+	// transparent output is BGRA with the alpha taken from the glyph coverage
+	cv::Mat render(bool color, bool transparent = false);
 
 	void output_text(const string& src_path, const string& dest_path);
+	void output_text(const cv::Mat& image, const string& dest_path);
 
 	ASCIIConverter(int width);// constructor	
 
+	cv::Mat convert(const int width, bool color);
+
 	void open_image(const string& img_path);
+	static cv::Mat read_image(const string& img_path); // decoded BGR, empty when the file can't be read
+	void open_image(const cv::Mat& image);
 	void resize_image();
 	void get_ascii_image_dimensions();
 	cv::Size get_text_size(const string& text, int font_face, double font_scale, int thickness, int* base_line);
 	
-	cv::Mat create_ascii_image();
-	void save_image(const cv::Mat& image_to_save);
+	cv::Mat create_ascii_image(bool transparent = false);
+	void create_ascii_image(cv::Mat& canvas, bool transparent = false);
+	void render_rows(cv::Mat& canvas, int row_begin, int row_end);
+
+	void set_width(int width);
+	void set_colorize(bool color);
+	void set_verbose(bool verbose);
+	bool has_source() const;
+
+	void set_worker_count(int workers);
+	int get_worker_count() const;
+	void save_image(const cv::Mat& image_to_save, const string& dest_path = "ascii_converted_image.png");
 	
 	void ascii_conversion();
-	void write_to_file(const string& dest_path);
+	bool write_to_file(const string& dest_path); // false when the file can't be opened or written
+	void write_to_stream(std::ostream& out);
+	void set_text_chunk_size(size_t bytes);
 
-	void save_image_with_opacity(const cv::Mat& image);
+	// turns the near white background of an already rendered image transparent (gray and BGRA are converted to BGR first)
+	void save_image_with_opacity(const cv::Mat& image, const string& dest_path = "ascii_art_transparent.png");
 
 };
\ No newline at end of file
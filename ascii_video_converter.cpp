@@ -0,0 +1,185 @@
+#include "ascii_video_converter.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using cv::Mat;
+using std::cerr;
+using std::endl;
+
+
+ASCIIVideoConverter::ASCIIVideoConverter() : m_converter(100)
+{
+	m_converter.set_verbose(false);
+}
+
+int ASCIIVideoConverter::convert(const string& src_path, const Options& options)
+{
+	cv::VideoCapture capture(src_path);
+
+	if (!capture.isOpened())
+	{
+		cerr << "File error: could not open video " << src_path << endl;
+		return -1;
+	}
+
+	m_source_fps = capture.get(cv::CAP_PROP_FPS);
+
+	if (m_source_fps <= 0.0)
+	{
+		m_source_fps = 25.0; // animated images often don't report a rate
+	}
+
+	if (!options.text_path.empty())
+	{
+		m_text_file.open(options.text_path);
+
+		if (!m_text_file.is_open())
+		{
+			cerr << "Error loading the file: " << options.text_path << endl;
+			return -1;
+		}
+	}
+
+	m_converter.set_width(options.width);
+	m_converter.set_colorize(options.color);
+	m_converter.set_worker_count(options.render_workers);
+
+	// two frame slots: the decoder fills one while the other is being converted
+	Mat frames[2];
+	bool filled[2] = { false, false };
+	bool finished = false; // decoder reached the end of the stream
+	bool aborted = false; // converter failed, decoder should stop
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::thread decoder([&]()
+	{
+		for (int slot = 0; ; slot ^= 1)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&]() { return !filled[slot] || aborted; });
+
+				if (aborted)
+				{
+					return;
+				}
+			}
+
+			// the slot is owned by the decoder until it is marked as filled
+			bool got_frame = capture.read(frames[slot]) && !frames[slot].empty();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (got_frame)
+				{
+					filled[slot] = true;
+				}
+				else
+				{
+					finished = true;
+				}
+			}
+
+			changed.notify_all();
+
+			if (!got_frame)
+			{
+				return;
+			}
+		}
+	});
+
+	int frame_count = 0;
+
+	for (int slot = 0; ; slot ^= 1)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&]() { return filled[slot] || finished; });
+
+			if (!filled[slot])
+			{
+				break; // end of stream and nothing left to convert
+			}
+		}
+
+		bool written = write_frame(frames[slot], options);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			filled[slot] = false;
+			aborted = !written;
+		}
+
+		changed.notify_all();
+
+		if (!written)
+		{
+			frame_count = -1;
+			break;
+		}
+
+		++frame_count;
+	}
+
+	decoder.join();
+
+	m_writer.release();
+
+	if (m_text_file.is_open())
+	{
+		m_text_file.close();
+	}
+
+	return frame_count;
+}
+
+bool ASCIIVideoConverter::write_frame(const Mat& frame, const Options& options)
+{
+	// same stages as ASCIIConverter::process, but everything renders into reused buffers
+	m_converter.open_image(frame);
+	m_converter.resize_image();
+	m_converter.ascii_conversion();
+
+	if (m_text_file.is_open())
+	{
+		m_converter.write_to_stream(m_text_file);
+		m_text_file << '\f' << '\n'; // frame separator
+
+		if (!m_text_file)
+		{
+			cerr << "Error writing the file: " << options.text_path << endl;
+			return false;
+		}
+	}
+
+	if (!options.video_path.empty())
+	{
+		m_converter.get_ascii_image_dimensions();
+		m_converter.create_ascii_image(m_canvas);
+
+		// the output size is only known after the first frame has been laid out
+		if (!m_writer.isOpened())
+		{
+			int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+
+			if (!m_writer.open(options.video_path, fourcc, m_source_fps, m_canvas.size(), true))
+			{
+				cerr << "Error opening the video output: " << options.video_path << endl;
+				return false;
+			}
+		}
+
+		m_writer.write(m_canvas);
+	}
+
+	return true;
+}
+
+double ASCIIVideoConverter::get_source_fps() const
+{
+	return m_source_fps;
+}
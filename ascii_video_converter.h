@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ascii_converter.h"
+#include <fstream>
+
+// Frame stream mode for the ASCII filter: video files and animated images
+// are pulled through cv::VideoCapture and turned into ASCII text frames and/or a rendered video.
+// Decoding runs one frame ahead on its own thread, and all frame, grid and canvas
+// buffers are reused so the steady state does not allocate.
+class ASCIIVideoConverter
+{
+public:
+	struct Options
+	{
+		int width = 100;
+		bool color = false;
+		string text_path; // all frames in one file, separated by a form feed line, empty = no text
+		string video_path; // rendered ASCII video (MJPG), empty = no video
+		int render_workers = 0; // row bands per frame, 0 = one per core
+	};
+
+	ASCIIVideoConverter();
+
+	// returns the number of converted frames, -1 when the source or an output can't be opened
+	int convert(const string& src_path, const Options& options);
+
+	double get_source_fps() const;
+
+private:
+	bool write_frame(const cv::Mat& frame, const Options& options);
+
+	ASCIIConverter m_converter;
+	cv::Mat m_canvas; // rendered frame, reused
+	cv::VideoWriter m_writer;
+	std::ofstream m_text_file;
+
+	double m_source_fps = 0.0;
+};
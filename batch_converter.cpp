@@ -0,0 +1,441 @@
+#include "batch_converter.h"
+#include "ascii_converter.h"
+#include "ascii_video_converter.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // accumulated wall time per pipeline stage, in seconds
+    struct StageTimes
+    {
+        double decode = 0.0;
+        double grayscale = 0.0;
+        double resize = 0.0;
+        double mapping = 0.0;
+        double render = 0.0;
+        double write = 0.0;
+        double video = 0.0; // whole frame stream conversions
+
+        int converted = 0;
+        int failed = 0;
+        int videos = 0;
+        int frames = 0;
+
+        void add(const StageTimes& other)
+        {
+            decode += other.decode;
+            grayscale += other.grayscale;
+            resize += other.resize;
+            mapping += other.mapping;
+            render += other.render;
+            write += other.write;
+            video += other.video;
+            converted += other.converted;
+            failed += other.failed;
+            videos += other.videos;
+            frames += other.frames;
+        }
+    };
+
+    double seconds_since(Clock::time_point& start)
+    {
+        auto now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        start = now;
+        return elapsed;
+    }
+
+    void print_stage(const char* name, double total_seconds, int images)
+    {
+        double per_image_ms = images > 0 ? total_seconds * 1000.0 / images : 0.0;
+        cout << "stage " << name << " total_s " << total_seconds << " per_image_ms " << per_image_ms << endl;
+    }
+}
+
+
+BatchConverter::BatchConverter(const BatchOptions& options) : m_options(options)
+{
+}
+
+bool BatchConverter::is_batch_invocation(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--batch") == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BatchConverter::parse_arguments(const QStringList& arguments, BatchOptions& options, QString& error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless ASCII conversion");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Image files or folders to convert.", "<inputs...>");
+
+    QCommandLineOption batch_option("batch", "Run without the GUI.");
+    QCommandLineOption output_option({ "o", "out" }, "Destination folder.", "folder");
+    QCommandLineOption width_option({ "w", "width" }, "Number of symbols per line.", "columns", QString::number(options.width));
+    QCommandLineOption color_option("color", "Color the ASCII symbols in the PNG output.");
+    QCommandLineOption text_option("text", "Write .txt files (default when no output type is given).");
+    QCommandLineOption png_option("png", "Write rendered .png files.");
+    QCommandLineOption transparent_option("transparent", "Render .png files on a transparent background (still images only).");
+    QCommandLineOption animated_option("animated", "Convert every frame of animated GIFs, not just the first.");
+    QCommandLineOption workers_option({ "j", "workers" }, "Worker threads, 0 uses every core.", "count", "0");
+
+    parser.addOptions({ batch_option, output_option, width_option, color_option, text_option, png_option, transparent_option, animated_option, workers_option });
+
+    if (!parser.parse(arguments))
+    {
+        error = parser.errorText();
+        return false;
+    }
+
+    if (parser.isSet("help"))
+    {
+        error = parser.helpText();
+        return false;
+    }
+
+    options.inputs = parser.positionalArguments();
+    options.output_folder = parser.value(output_option);
+    options.color = parser.isSet(color_option);
+    options.animated = parser.isSet(animated_option);
+
+    bool width_ok = false;
+    options.width = parser.value(width_option).toInt(&width_ok);
+
+    bool workers_ok = false;
+    options.workers = parser.value(workers_option).toInt(&workers_ok);
+
+    options.transparent = parser.isSet(transparent_option);
+    options.write_png = parser.isSet(png_option) || options.transparent;
+    options.write_text = parser.isSet(text_option) || !options.write_png;
+
+    if (options.inputs.isEmpty())
+    {
+        error = "No input files or folders given";
+        return false;
+    }
+
+    if (options.output_folder.isEmpty())
+    {
+        error = "No output folder given, use --out <folder>";
+        return false;
+    }
+
+    if (!width_ok || options.width <= 0)
+    {
+        error = "Invalid width";
+        return false;
+    }
+
+    if (!workers_ok || options.workers < 0)
+    {
+        error = "Invalid worker count";
+        return false;
+    }
+
+    return true;
+}
+
+int BatchConverter::run_from_command_line(const QStringList& arguments)
+{
+    BatchOptions options;
+    QString error;
+
+    if (!parse_arguments(arguments, options, error))
+    {
+        std::cerr << error.toStdString() << endl;
+        return 1;
+    }
+
+    BatchConverter batch(options);
+    return batch.run();
+}
+
+QStringList BatchConverter::collect_files() const
+{
+    //File types, videos go through the frame stream converter
+    QStringList filters = { "*.png", "*.jpg", "*.jpeg", "*.bmp", "*.gif", "*.tiff", "*.webp",
+                            "*.mp4", "*.avi", "*.mov", "*.mkv", "*.webm" };
+
+    QStringList files;
+
+    for (const QString& input : m_options.inputs)
+    {
+        QFileInfo info(input);
+
+        if (info.isDir())
+        {
+            QDir dir(input);
+
+            for (const QString& file_name : dir.entryList(filters, QDir::Files))
+            {
+                files.append(dir.absoluteFilePath(file_name));
+            }
+        }
+
+        else if (info.isFile())
+        {
+            files.append(info.absoluteFilePath());
+        }
+
+        else
+        {
+            std::cerr << "Skipping missing input: " << input.toStdString() << endl;
+        }
+    }
+
+    return files;
+}
+
+bool BatchConverter::is_frame_stream(const QString& path) const
+{
+    static const QStringList video_suffixes = { "mp4", "avi", "mov", "mkv", "webm" };
+
+    QString suffix = QFileInfo(path).suffix().toLower();
+
+    return video_suffixes.contains(suffix) || (m_options.animated && suffix == "gif");
+}
+
+int BatchConverter::run()
+{
+    const QStringList files = collect_files();
+
+    if (files.isEmpty())
+    {
+        std::cerr << "No images found" << endl;
+        return 1;
+    }
+
+    // frame streams render to MJPG, which has no alpha channel, so the flag can't be honoured there
+    if (m_options.transparent)
+    {
+        for (const QString& path : files)
+        {
+            if (is_frame_stream(path))
+            {
+                std::cerr << "--transparent only applies to still images, the video output of "
+                    << path.toStdString() << " can't be transparent" << endl;
+                return 1;
+            }
+        }
+    }
+
+    QDir output_dir(m_options.output_folder);
+
+    if (!output_dir.exists() && !output_dir.mkpath("."))
+    {
+        std::cerr << "Could not create output folder: " << m_options.output_folder.toStdString() << endl;
+        return 1;
+    }
+
+    // outputs keep the source suffix (a.jpg -> a.jpg.txt) so a.jpg and a.png don't overwrite each
+    // other; same named files from different input folders still collide and are reported instead
+    QStringList base_names;
+    QHash<QString, QString> claimed; // lowercased output base -> the input that writes it
+    int collisions = 0;
+
+    for (const QString& path : files)
+    {
+        QString base_name = output_dir.absoluteFilePath(QFileInfo(path).fileName());
+        QString key = base_name.toLower(); // the output folder may be case insensitive
+        auto owner = claimed.find(key);
+
+        if (owner != claimed.end())
+        {
+            std::cerr << "Output name collision: " << path.toStdString() << " would overwrite the output of "
+                << owner.value().toStdString() << ", skipped" << endl;
+            base_names.append(QString());
+            ++collisions;
+            continue;
+        }
+
+        claimed.insert(key, path);
+        base_names.append(base_name);
+    }
+
+    int workers = m_options.workers > 0 ? m_options.workers : QThread::idealThreadCount();
+    workers = qBound(1, workers, static_cast<int>(files.size()));
+
+    std::atomic<int> next_file(0);
+    std::mutex totals_mutex;
+    StageTimes totals;
+
+    auto worker = [&]()
+    {
+        // one converter per thread, its grid, atlas and staging buffers survive across images
+        ASCIIConverter converter(m_options.width);
+        converter.set_width(m_options.width);
+        converter.set_colorize(m_options.color);
+        converter.set_verbose(false);
+        converter.set_worker_count(1); // parallelism comes from the pool, not from the bands
+
+        std::unique_ptr<ASCIIVideoConverter> video_converter; // created on the first video
+
+        cv::Mat rendered; // reused output canvas
+
+        StageTimes local;
+
+        for (int index = next_file++; index < files.size(); index = next_file++)
+        {
+            const QString& path = files[index];
+            const QString& base_name = base_names[index];
+
+            if (base_name.isEmpty())
+            {
+                continue; // collision, reported and counted before the workers started
+            }
+
+            auto stage_start = Clock::now();
+
+            if (is_frame_stream(path))
+            {
+                if (!video_converter)
+                {
+                    video_converter = std::make_unique<ASCIIVideoConverter>();
+                }
+
+                ASCIIVideoConverter::Options video_options;
+                video_options.width = m_options.width;
+                video_options.color = m_options.color;
+                video_options.render_workers = 1;
+                video_options.text_path = m_options.write_text ? (base_name + ".txt").toStdString() : string();
+                video_options.video_path = m_options.write_png ? (base_name + ".avi").toStdString() : string();
+
+                int frames = video_converter->convert(path.toStdString(), video_options);
+                local.video += seconds_since(stage_start);
+
+                if (frames < 0)
+                {
+                    ++local.failed;
+                    continue;
+                }
+
+                local.frames += frames;
+                ++local.videos;
+                continue;
+            }
+
+            // mapped rather than read, imdecode works straight on the file pages
+            cv::Mat image = ASCIIConverter::read_image(path.toStdString());
+
+            local.decode += seconds_since(stage_start);
+
+            if (image.empty())
+            {
+                std::cerr << "File error: could not open " << path.toStdString() << endl;
+                ++local.failed;
+                continue;
+            }
+
+            converter.open_image(image);
+            local.grayscale += seconds_since(stage_start);
+
+            converter.resize_image();
+            local.resize += seconds_since(stage_start);
+
+            converter.ascii_conversion();
+            local.mapping += seconds_since(stage_start);
+
+            if (m_options.write_png)
+            {
+                converter.get_ascii_image_dimensions();
+                converter.create_ascii_image(rendered, m_options.transparent);
+                local.render += seconds_since(stage_start);
+            }
+
+            bool written = true;
+
+            if (m_options.write_text)
+            {
+                written = converter.write_to_file((base_name + ".txt").toStdString()) && written;
+            }
+
+            if (m_options.write_png && !cv::imwrite((base_name + ".png").toStdString(), rendered))
+            {
+                std::cerr << "Error writing the file: " << (base_name + ".png").toStdString() << endl;
+                written = false;
+            }
+
+            local.write += seconds_since(stage_start);
+
+            if (!written)
+            {
+                ++local.failed;
+                continue;
+            }
+
+            ++local.converted;
+        }
+
+        std::lock_guard<std::mutex> lock(totals_mutex);
+        totals.add(local);
+    };
+
+    totals.failed += collisions;
+
+    cout << "Converting " << files.size() << " images with " << workers << " workers" << endl;
+
+    auto start = Clock::now();
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+
+    for (int i = 0; i < workers; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+
+    double wall_seconds = seconds_since(start);
+
+    // one "key value" record per line so the summary is easy to parse
+    cout << std::fixed << std::setprecision(3);
+    cout << "images " << totals.converted << endl;
+    cout << "videos " << totals.videos << endl;
+    cout << "video_frames " << totals.frames << endl;
+    cout << "failed " << totals.failed << endl;
+    cout << "workers " << workers << endl;
+    cout << "wall_s " << wall_seconds << endl;
+    cout << "images_per_s " << (wall_seconds > 0.0 ? totals.converted / wall_seconds : 0.0) << endl;
+
+    // stage totals are summed over all workers (cpu time spent per stage, not wall time)
+    print_stage("decode", totals.decode, totals.converted);
+    print_stage("grayscale", totals.grayscale, totals.converted);
+    print_stage("resize", totals.resize, totals.converted);
+    print_stage("mapping", totals.mapping, totals.converted);
+    print_stage("render", totals.render, totals.converted);
+    print_stage("write", totals.write, totals.converted);
+    print_stage("video", totals.video, totals.frames);
+
+    return totals.failed == 0 ? 0 : 2;
+}
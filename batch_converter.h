@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// settings for a headless ASCII run, filled from the command line
+struct BatchOptions
+{
+    QStringList inputs; // folders and/or single files
+    QString output_folder;
+    int width = 100;
+    bool color = false;
+    bool write_text = true;
+    bool write_png = false;
+    bool transparent = false; // PNG background left transparent, alpha from glyph coverage
+    int workers = 0; // 0 = one per core
+    bool animated = false; // GIFs are converted frame by frame like videos
+};
+
+// converts many images to ASCII without the GUI
+// a fixed pool of threads pulls files from a shared counter, every thread owns one ASCIIConverter
+// so its buffers are reused from image to image
+class BatchConverter
+{
+public:
+    explicit BatchConverter(const BatchOptions& options);
+
+    int run(); // returns the process exit code
+
+    static bool is_batch_invocation(int argc, char* argv[]);
+    static bool parse_arguments(const QStringList& arguments, BatchOptions& options, QString& error);
+    static int run_from_command_line(const QStringList& arguments);
+
+private:
+    QStringList collect_files() const;
+    bool is_frame_stream(const QString& path) const;
+
+    BatchOptions m_options;
+};
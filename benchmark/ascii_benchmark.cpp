@@ -0,0 +1,178 @@
+// Stage by stage micro-benchmark for ASCIIConverter.
+// Builds as its own executable from this file plus ascii_converter.cpp, glyph_atlas.cpp and
+// mapped_file.cpp (OpenCV, and Qt Core for the converter's file input and qDebug output).
+// From the repository root, with the OpenCV 4 and Qt 6 development packages installed:
+//
+//   g++ -std=c++17 -O2 -fPIC benchmark/ascii_benchmark.cpp ascii_converter.cpp glyph_atlas.cpp mapped_file.cpp \
+//       -o ascii_benchmark $(pkg-config --cflags --libs opencv4 Qt6Core)
+//
+// (Qt 5 works the same with Qt5Core.) Build with optimizations, the numbers mean nothing otherwise.
+//
+// usage: ascii_benchmark [--iterations N] [--workers N] [--quick]
+// prints one CSV record per (image size, width, mode, stage):
+//   size,width,mode,stage,median_ms,min_ms,iterations
+
+#include "../ascii_converter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double median_ms;
+        double min_ms;
+    };
+
+    // runs the step `iterations` times and keeps the median and the best run
+    Result measure(int iterations, const std::function<void()>& step)
+    {
+        vector<double> samples;
+        samples.reserve(iterations);
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = Clock::now();
+            step();
+            samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        return { samples[samples.size() / 2], samples.front() };
+    }
+
+    // smooth gradients plus noise, so every charset symbol and plenty of colors show up
+    cv::Mat make_synthetic_image(cv::Size size)
+    {
+        cv::Mat image(size, CV_8UC3);
+
+        for (int y = 0; y < size.height; ++y)
+        {
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+
+            for (int x = 0; x < size.width; ++x)
+            {
+                row[x] = cv::Vec3b(static_cast<uchar>(x * 255 / size.width),
+                                   static_cast<uchar>(y * 255 / size.height),
+                                   static_cast<uchar>((x + y) & 0xFF));
+            }
+        }
+
+        cv::Mat noise(size, CV_8UC3);
+        cv::randu(noise, cv::Scalar(0, 0, 0), cv::Scalar(48, 48, 48));
+        image += noise;
+
+        return image;
+    }
+
+    void print(const cv::Size& size, int width, const char* mode, const char* stage, const Result& result, int iterations)
+    {
+        cout << size.width << "x" << size.height << "," << width << "," << mode << "," << stage << ","
+             << result.median_ms << "," << result.min_ms << "," << iterations << endl;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int iterations = 15;
+    int workers = 0;
+    bool quick = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+        {
+            workers = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            quick = true;
+        }
+        else
+        {
+            std::cerr << "usage: ascii_benchmark [--iterations N] [--workers N] [--quick]" << endl;
+            return 1;
+        }
+    }
+
+    const vector<cv::Size> sizes = quick
+        ? vector<cv::Size>{ cv::Size(640, 480), cv::Size(1920, 1080) }
+        : vector<cv::Size>{ cv::Size(640, 480), cv::Size(1920, 1080), cv::Size(4000, 3000), cv::Size(7952, 5304) };
+
+    // the detail slider range of the viewer
+    const vector<int> widths = quick ? vector<int>{ 55, 220 } : vector<int>{ 55, 80, 110, 165, 220 };
+
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+
+    ASCIIConverter converter(widths.front());
+    converter.set_verbose(false);
+    converter.set_worker_count(workers);
+
+    cout << std::fixed << std::setprecision(3);
+    cout << "size,width,mode,stage,median_ms,min_ms,iterations" << endl;
+
+    for (const cv::Size& size : sizes)
+    {
+        cv::Mat source = make_synthetic_image(size);
+
+        // open_image_file is the whole open_image(path) call on a real file, decode plus grayscale,
+        // open_image is the grayscale conversion of an image already in memory
+        const std::string path = (temp_dir / ("ascii_benchmark_" + std::to_string(size.width) + ".jpg")).string();
+        cv::imwrite(path, source);
+
+        print(size, 0, "-", "open_image_file", measure(iterations, [&]() { converter.open_image(path); }), iterations);
+        print(size, 0, "-", "open_image", measure(iterations, [&]() { converter.open_image(source); }), iterations);
+
+        for (int width : widths)
+        {
+            for (bool color : { false, true })
+            {
+                const char* mode = color ? "color" : "mono";
+
+                converter.set_width(width);
+                converter.set_colorize(color);
+
+                // resize and conversion don't depend on the color mode, time them once per width
+                if (!color)
+                {
+                    print(size, width, mode, "resize_image", measure(iterations, [&]() { converter.resize_image(); }), iterations);
+                    print(size, width, mode, "ascii_conversion", measure(iterations, [&]() { converter.ascii_conversion(); }), iterations);
+                    print(size, width, mode, "get_ascii_image_dimensions", measure(iterations, [&]() { converter.get_ascii_image_dimensions(); }), iterations);
+                }
+
+                converter.resize_image();
+                converter.ascii_conversion();
+                converter.get_ascii_image_dimensions();
+
+                cv::Mat canvas;
+                print(size, width, mode, "create_ascii_image", measure(iterations, [&]() { converter.create_ascii_image(canvas); }), iterations);
+
+                cv::Mat result;
+                print(size, width, mode, "process", measure(iterations, [&]() { result = converter.process(source, width, color); }), iterations);
+            }
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    return 0;
+}
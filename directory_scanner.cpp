@@ -0,0 +1,253 @@
+#include "directory_scanner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QThread>
+#include <algorithm>
+
+
+DirectoryScanner::DirectoryScanner(QObject* parent)
+    : QObject(parent)
+{
+    // directory listing is mostly waiting on the file system, a few threads keep several requests in flight
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    cancel();
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+const QStringList& DirectoryScanner::image_name_filters()
+{
+    static const QStringList filters = {"*.png", "*.jpg", "*.jpeg", "*.bmp", "*.gif", "*.tiff", "*.webp"};
+    return filters;
+}
+
+bool DirectoryScanner::name_less(const QString& a, const QString& b)
+{
+    int result = QString::compare(a, b, Qt::CaseInsensitive);
+
+    // tie break so names differing only in case keep a fixed order
+    return result != 0 ? result < 0 : a < b;
+}
+
+void DirectoryScanner::set_options(const Options& options)
+{
+    m_options = options;
+}
+
+const DirectoryScanner::Options& DirectoryScanner::get_options() const
+{
+    return m_options;
+}
+
+void DirectoryScanner::start(const QString& folder, quint64 generation, bool stream)
+{
+    cancel();
+
+    CancelFlag cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_cancelled = cancelled;
+
+    ScanHandle scan = std::make_shared<ScanState>();
+    scan->root = QDir(folder).absolutePath();
+    scan->generation = generation;
+    scan->stream = stream;
+    scan->options = m_options;
+    scan->cancelled = cancelled;
+    scan->batch_timer.start();
+
+    if (!scan->root.endsWith('/'))
+    {
+        scan->root += '/';
+    }
+
+    for (const QString& pattern : m_options.exclude_patterns)
+    {
+        scan->excludes.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern), QRegularExpression::CaseInsensitiveOption));
+    }
+
+    start_directory(scan, QString(), 0);
+}
+
+void DirectoryScanner::cancel()
+{
+    if (m_cancelled)
+    {
+        m_cancelled->store(true);
+    }
+}
+
+void DirectoryScanner::start_directory(const ScanHandle& scan, const QString& relative_dir, int depth)
+{
+    // counted before the job exists, so the scan can't look finished while a child is still queued
+    scan->pending_directories.fetch_add(1);
+
+    QRunnable* runnable = QRunnable::create([this, scan, relative_dir, depth]()
+    {
+        scan_directory(scan, relative_dir, depth);
+
+        if (scan->pending_directories.fetch_sub(1) == 1)
+        {
+            finish_scan(scan);
+        }
+    });
+
+    m_pool.start(runnable);
+}
+
+void DirectoryScanner::scan_directory(const ScanHandle& scan, const QString& relative_dir, int depth)
+{
+    if (scan->cancelled->load())
+    {
+        return;
+    }
+
+    bool descend = scan->options.recursive && (scan->options.max_depth < 0 || depth < scan->options.max_depth);
+
+    // AllDirs lists directories regardless of the name filters
+    QDir::Filters filters = QDir::Files;
+
+    if (descend)
+    {
+        filters |= QDir::AllDirs | QDir::NoDotAndDotDot;
+    }
+
+    // one readdir pass, the entry type comes with it so there are no stat calls
+    QDirIterator it(scan->root + relative_dir, image_name_filters(), filters);
+
+    QStringList names;
+
+    while (it.hasNext())
+    {
+        if (scan->cancelled->load())
+        {
+            return;
+        }
+
+        it.next();
+
+        QString name = it.fileName();
+
+        if (is_excluded(*scan, name))
+        {
+            continue;
+        }
+
+        QFileInfo info = it.fileInfo();
+
+        if (info.isDir())
+        {
+            // symlinked directories could loop back into the tree
+            if (!info.isSymLink())
+            {
+                start_directory(scan, relative_dir + name + '/', depth + 1);
+            }
+
+            continue;
+        }
+
+        names.append(relative_dir + name);
+
+        // the very first file of the scan is handed over alone, later ones in chunks
+        if (names.size() >= directory_chunk || !scan->first_sent.load())
+        {
+            add_files(scan, names);
+        }
+    }
+
+    add_files(scan, names);
+}
+
+bool DirectoryScanner::is_excluded(const ScanState& scan, const QString& name)
+{
+    for (const QRegularExpression& exclude : scan.excludes)
+    {
+        if (exclude.match(name).hasMatch())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DirectoryScanner::add_files(const ScanHandle& scan, QStringList& names)
+{
+    if (names.isEmpty())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(scan->mutex);
+
+    scan->all_names.append(names);
+    scan->batch.append(names);
+    names.clear();
+
+    if (scan->batch.size() >= scan->batch_size || scan->batch_timer.elapsed() >= max_batch_ms)
+    {
+        send_batch(scan, scan->batch);
+        scan->batch.clear();
+
+        scan->batch_size = qMin(scan->batch_size * 2, static_cast<int>(max_batch_size));
+        scan->batch_timer.restart();
+        scan->first_sent.store(true);
+    }
+}
+
+void DirectoryScanner::send_batch(const ScanHandle& scan, const QStringList& names)
+{
+    if (!scan->stream)
+    {
+        return;
+    }
+
+    CancelFlag cancelled = scan->cancelled;
+    quint64 generation = scan->generation;
+
+    QMetaObject::invokeMethod(this, [this, generation, cancelled, names]()
+    {
+        if (!cancelled->load())
+        {
+            emit files_found(generation, names);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void DirectoryScanner::finish_scan(const ScanHandle& scan)
+{
+    if (scan->cancelled->load())
+    {
+        return;
+    }
+
+    QStringList all_names;
+
+    {
+        std::lock_guard<std::mutex> lock(scan->mutex);
+
+        if (!scan->batch.isEmpty())
+        {
+            send_batch(scan, scan->batch);
+            scan->batch.clear();
+        }
+
+        all_names.swap(scan->all_names);
+    }
+
+    // directories finish in any order, sorting makes the final listing the same every time
+    std::sort(all_names.begin(), all_names.end(), name_less);
+
+    CancelFlag cancelled = scan->cancelled;
+    quint64 generation = scan->generation;
+
+    QMetaObject::invokeMethod(this, [this, generation, cancelled, all_names]()
+    {
+        if (!cancelled->load())
+        {
+            emit finished(generation, all_names);
+        }
+    }, Qt::QueuedConnection);
+}
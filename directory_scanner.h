@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Lists the images of a folder on worker threads, one readdir pass per directory.
+// Names are streamed back in directory order as they are found, the first one right away so
+// the viewer can show it before the listing is done; finished() delivers the sorted listing.
+// Refreshes of a folder that is already listed skip the streaming and only report the result.
+// In recursive mode every subdirectory is its own job, so a tree is walked on several threads.
+class DirectoryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        bool recursive = false;
+        int max_depth = -1; // subdirectory levels below the folder, -1 = no limit
+        QStringList exclude_patterns; // wildcards matched against file and directory names
+    };
+
+    explicit DirectoryScanner(QObject* parent = nullptr);
+    ~DirectoryScanner();
+
+    static const QStringList& image_name_filters();
+    static bool name_less(const QString& a, const QString& b); // list order, like QDir's default name sort
+
+    void set_options(const Options& options); // used from the next start()
+    const Options& get_options() const;
+
+    // cancels any running scan, results are tagged with generation
+    void start(const QString& folder, quint64 generation, bool stream = true);
+    void cancel();
+
+signals:
+    void files_found(quint64 generation, const QStringList& names); // relative to the folder
+    void finished(quint64 generation, const QStringList& sorted_names);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic<bool>>;
+
+    // shared by all directory jobs of one scan
+    struct ScanState
+    {
+        QString root; // with a trailing separator
+        quint64 generation = 0;
+        bool stream = true;
+        Options options;
+        QVector<QRegularExpression> excludes;
+        CancelFlag cancelled;
+
+        std::atomic<int> pending_directories{ 0 };
+        std::atomic<bool> first_sent{ false };
+
+        std::mutex mutex; // guards everything below
+        QStringList all_names;
+        QStringList batch;
+        int batch_size = 1; // the first file goes out alone, batches grow from there
+        QElapsedTimer batch_timer;
+    };
+
+    using ScanHandle = std::shared_ptr<ScanState>;
+
+    void start_directory(const ScanHandle& scan, const QString& relative_dir, int depth);
+    void scan_directory(const ScanHandle& scan, const QString& relative_dir, int depth);
+    void add_files(const ScanHandle& scan, QStringList& names);
+    void finish_scan(const ScanHandle& scan);
+    void send_batch(const ScanHandle& scan, const QStringList& names);
+
+    static bool is_excluded(const ScanState& scan, const QString& name);
+
+    QThreadPool m_pool;
+    CancelFlag m_cancelled;
+    Options m_options;
+
+    static constexpr int max_batch_size = 1024;
+    static constexpr int max_batch_ms = 100; // flush at least this often while files keep coming
+    static constexpr int directory_chunk = 256; // files a job collects before taking the lock
+};
@@ -0,0 +1,107 @@
+#include "fast_blur.h"
+#include <cmath>
+
+
+static constexpr int border = cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED;
+
+int FastBlur::passes(Quality quality)
+{
+    return quality == Quality::accurate ? 5 : 3;
+}
+
+int FastBlur::temporaries(Quality quality)
+{
+    // float buffers are four times the size of the 8 bit image
+    return quality == Quality::accurate ? 9 : 2;
+}
+
+std::vector<int> FastBlur::box_sizes(double sigma, int passes)
+{
+    // a box of width w has variance (w * w - 1) / 12, pick the two odd widths around the ideal
+    // one and how many passes use the smaller so the variances add up to sigma squared
+    double variance = 12.0 * sigma * sigma;
+    int lower = static_cast<int>(std::floor(std::sqrt(variance / passes + 1)));
+
+    if (lower % 2 == 0)
+    {
+        --lower;
+    }
+
+    lower = std::max(lower, 1);
+    int upper = lower + 2;
+
+    double ideal = (variance - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes) / (-4.0 * lower - 4.0);
+    int lower_count = std::max(0, std::min(passes, cvRound(ideal)));
+
+    std::vector<int> sizes;
+
+    for (int i = 0; i < passes; ++i)
+    {
+        sizes.push_back(i < lower_count ? lower : upper);
+    }
+
+    return sizes;
+}
+
+int FastBlur::radius(double sigma, Quality quality)
+{
+    if (sigma < exact_sigma_limit)
+    {
+        // the kernel size cv::GaussianBlur picks for 8 bit images
+        return (cvRound(sigma * 3 * 2 + 1) | 1) / 2;
+    }
+
+    int total = 0;
+
+    for (int size : box_sizes(sigma, passes(quality)))
+    {
+        total += size / 2;
+    }
+
+    return total;
+}
+
+void FastBlur::apply(const cv::Mat& input, cv::Mat& output, double sigma, Quality quality)
+{
+    if (sigma <= 0)
+    {
+        input.copyTo(output);
+        return;
+    }
+
+    if (sigma < exact_sigma_limit)
+    {
+        cv::GaussianBlur(input, output, cv::Size(0, 0), sigma, sigma, border);
+        return;
+    }
+
+    std::vector<int> sizes = box_sizes(sigma, passes(quality));
+
+    if (quality == Quality::fast)
+    {
+        // 8 bit in and out, every pass rounds but the passes are few
+        cv::Mat current = input;
+
+        for (int size : sizes)
+        {
+            cv::Mat next;
+            cv::boxFilter(current, next, -1, cv::Size(size, size), cv::Point(-1, -1), true, border);
+            current = next;
+        }
+
+        output = current;
+        return;
+    }
+
+    cv::Mat current;
+    cv::Mat next;
+    input.convertTo(current, CV_32F);
+
+    for (int size : sizes)
+    {
+        cv::boxFilter(current, next, -1, cv::Size(size, size), cv::Point(-1, -1), true, border);
+        cv::swap(current, next); // the two float buffers are reused by every pass
+    }
+
+    current.convertTo(output, input.type()); // rounds and saturates
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Gaussian blur whose cost per pixel doesn't depend on sigma.
+// The Gaussian is approximated by a stack of box blurs (central limit theorem), each box is
+// a running sum so a sigma of 100 costs the same as a sigma of 3. cv::boxFilter walks the
+// interleaved channels of a row in one vectorized loop rather than one channel at a time.
+// fast runs three 8 bit passes; accurate runs five passes in float and rounds once at the
+// end, which follows the Gaussian's shape more closely. Small sigmas use the exact kernel,
+// it has only a few taps there.
+class FastBlur
+{
+public:
+    enum class Quality
+    {
+        fast,
+        accurate
+    };
+
+    // output may be the input, borders reflect like cv::GaussianBlur's default
+    static void apply(const cv::Mat& input, cv::Mat& output, double sigma, Quality quality);
+
+    // rows (and columns) on each side that contribute to an output pixel, the halo a band needs
+    static int radius(double sigma, Quality quality);
+
+    // odd box widths whose stacked variance matches sigma
+    static std::vector<int> box_sizes(double sigma, int passes);
+
+    // band sized buffers apply() allocates for one band
+    static int temporaries(Quality quality);
+
+private:
+    static int passes(Quality quality);
+
+    static constexpr double exact_sigma_limit = 2.0; // kernel of at most 13 taps
+};
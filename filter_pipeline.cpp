@@ -0,0 +1,333 @@
+#include "filter_pipeline.h"
+#include <QStringList>
+
+
+static int odd_kernel(int size, double scale)
+{
+    // a kernel covers the same part of the picture at any resolution
+    size = qMax(1, qRound(size * scale));
+
+    // Gaussian kernels must be odd
+    return size % 2 == 0 ? size + 1 : size;
+}
+
+// kernel radius OpenCV picks for an 8 bit image when only sigma is given
+static int gaussian_radius(const cv::Size& kernel, double sigma)
+{
+    int size = kernel.height > 0 ? kernel.height : (cvRound(sigma * 3 * 2 + 1) | 1);
+    return size / 2;
+}
+
+// rows per band so that the bands being filtered at once, halo included, fit in the budget
+// temporaries is the number of band sized buffers one band needs
+static int band_rows(const cv::Mat& image, int halo, int temporaries, qint64 budget)
+{
+    qint64 workers = qMax(1, cv::getNumThreads());
+    qint64 row_bytes = static_cast<qint64>(image.cols) * image.elemSize() * temporaries;
+    qint64 rows = budget / workers / qMax<qint64>(1, row_bytes) - 2 * halo;
+
+    // very small budgets still get bands that are mostly payload rather than halo
+    return static_cast<int>(qBound<qint64>(qMin(qMax(halo, 16), image.rows), rows, image.rows));
+}
+
+// runs filter over horizontal bands of input in parallel, each band with halo extra rows on
+// both sides so the rows it keeps are exactly what the whole image filter would give
+// filter writes a band sized result, the rows without halo are copied into output
+template <typename Filter>
+static void filter_bands(const cv::Mat& input, cv::Mat& output, int output_type, int halo, int temporaries, qint64 budget, Filter filter)
+{
+    output.create(input.size(), output_type);
+
+    int rows = band_rows(input, halo, temporaries, budget);
+    int bands = (input.rows + rows - 1) / rows;
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range)
+    {
+        for (int band = range.start; band < range.end; ++band)
+        {
+            int begin = band * rows;
+            int end = qMin(begin + rows, input.rows);
+            int top = qMax(0, begin - halo);
+            int bottom = qMin(input.rows, end + halo);
+
+            cv::Mat result;
+            filter(input.rowRange(top, bottom), result);
+
+            result.rowRange(begin - top, end - top).copyTo(output.rowRange(begin, end));
+        }
+    });
+}
+
+// Gaussian blur in bands, the band edges inside the image are covered by the halo and the
+// ones on the image border reflect exactly like the whole image blur does
+static void tiled_gaussian_blur(const cv::Mat& input, cv::Mat& output, const cv::Size& kernel, double sigma, qint64 budget)
+{
+    cv::Mat blurred; // output may be the input
+    int halo = gaussian_radius(kernel, sigma);
+
+    filter_bands(input, blurred, input.type(), halo, 2, budget, [&](const cv::Mat& band, cv::Mat& result)
+    {
+        cv::GaussianBlur(band, result, kernel, sigma, sigma, cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED);
+    });
+
+    output = blurred;
+}
+
+static qint64 frame_bytes(const cv::Mat& image)
+{
+    return static_cast<qint64>(image.total()) * image.elemSize();
+}
+
+static QString operation_name(FilterPipeline::Operation operation)
+{
+    switch (operation)
+    {
+    case FilterPipeline::Operation::blur: return "Blur";
+    case FilterPipeline::Operation::sharpen: return "Sharpened";
+    case FilterPipeline::Operation::contour: return "Contour";
+    case FilterPipeline::Operation::invert: return "Invert";
+    case FilterPipeline::Operation::grayscale: return "Grayscale";
+    }
+
+    return QString();
+}
+
+bool FilterPipeline::Step::same_parameters(const Step& other) const
+{
+    return operation == other.operation && kernel_size == other.kernel_size && sigma == other.sigma
+        && blur_quality == other.blur_quality && sharpen_amount == other.sharpen_amount
+        && low_threshold == other.low_threshold && high_threshold == other.high_threshold;
+}
+
+void FilterPipeline::set_source(const cv::Mat& source, qint64 source_id, double scale)
+{
+    m_source = source;
+    m_source_id = source_id;
+    m_scale = scale;
+    invalidate_from(0);
+}
+
+bool FilterPipeline::has_source(qint64 source_id) const
+{
+    return !m_source.empty() && m_source_id == source_id;
+}
+
+const cv::Mat& FilterPipeline::source() const
+{
+    return m_source;
+}
+
+void FilterPipeline::set_step(const Step& step)
+{
+    for (int i = 0; i < m_nodes.size(); ++i)
+    {
+        if (m_nodes[i].step.operation != step.operation)
+        {
+            continue;
+        }
+
+        m_edited = i;
+
+        // unchanged parameters keep every cached output
+        if (!m_nodes[i].step.same_parameters(step))
+        {
+            m_nodes[i].step = step;
+            invalidate_from(i);
+        }
+
+        return;
+    }
+
+    Node node;
+    node.step = step;
+    m_nodes.append(node);
+    m_edited = m_nodes.size() - 1;
+}
+
+void FilterPipeline::clear()
+{
+    m_nodes.clear();
+    m_edited = -1;
+    m_source.release();
+    m_source_id = 0;
+    m_scale = 1.0;
+}
+
+void FilterPipeline::set_memory_budget(qint64 bytes)
+{
+    m_memory_budget = qMax<qint64>(bytes, 1024 * 1024);
+}
+
+qint64 FilterPipeline::cached_bytes() const
+{
+    qint64 bytes = frame_bytes(m_source);
+
+    for (const Node& node : m_nodes)
+    {
+        bytes += frame_bytes(node.output);
+    }
+
+    return bytes;
+}
+
+bool FilterPipeline::empty() const
+{
+    return m_nodes.isEmpty();
+}
+
+QString FilterPipeline::description() const
+{
+    QStringList names;
+
+    for (const Node& node : m_nodes)
+    {
+        names.append(operation_name(node.step.operation));
+    }
+
+    return names.join(" + ");
+}
+
+void FilterPipeline::invalidate_from(int index)
+{
+    for (int i = index; i < m_nodes.size(); ++i)
+    {
+        m_nodes[i].valid = false;
+        m_nodes[i].output.release(); // stale, a copy on its way to the screen keeps its own reference
+    }
+}
+
+// the output being read, the last one and the input of the edited node are never dropped,
+// a dropped output is recomputed from the nearest cached one before it when it is needed again
+void FilterPipeline::trim_cache(int keep)
+{
+    for (int i = 0; i < m_nodes.size() && cached_bytes() > m_memory_budget; ++i)
+    {
+        if (i == keep || i == m_nodes.size() - 1 || i == m_edited - 1)
+        {
+            continue;
+        }
+
+        m_nodes[i].output.release();
+        m_nodes[i].valid = false;
+    }
+}
+
+const cv::Mat& FilterPipeline::result()
+{
+    if (m_nodes.isEmpty())
+    {
+        return m_source;
+    }
+
+    // walk back to the nearest output still cached, everything after it is recomputed
+    int first = m_nodes.size();
+
+    while (first > 0 && !m_nodes[first - 1].valid)
+    {
+        --first;
+    }
+
+    for (int i = first; i < m_nodes.size(); ++i)
+    {
+        Node& node = m_nodes[i];
+        const cv::Mat& input = i == 0 ? m_source : m_nodes[i - 1].output;
+
+        // a new buffer, an earlier result may still be on its way to the screen
+        node.output.release();
+
+        // make room for the new output, the bands get what the cached frames leave
+        trim_cache(i - 1);
+        qint64 band_budget = qMax(minimum_band_budget, m_memory_budget - cached_bytes() - frame_bytes(input));
+
+        apply(node.step, input, node.output, m_scale, band_budget);
+        node.valid = true;
+    }
+
+    trim_cache(m_nodes.size() - 1);
+
+    return m_nodes.last().output;
+}
+
+void FilterPipeline::apply(const Step& step, const cv::Mat& input, cv::Mat& output, double scale, qint64 budget)
+{
+    // every operation writes a new Mat, the input belongs to the node before
+    switch (step.operation)
+    {
+    case Operation::blur:
+    {
+        // box stack, the cost doesn't grow with sigma
+        double sigma = step.sigma * scale;
+        FastBlur::Quality quality = step.blur_quality;
+
+        filter_bands(input, output, input.type(), FastBlur::radius(sigma, quality), FastBlur::temporaries(quality), budget,
+            [&](const cv::Mat& band, cv::Mat& result)
+        {
+            FastBlur::apply(band, result, sigma, quality);
+        });
+        break;
+    }
+
+    case Operation::sharpen:
+    {
+        double sigma = 3 * scale;
+        double amount = step.sharpen_amount;
+
+        // the blurred version of the image only exists one band at a time
+        filter_bands(input, output, input.type(), gaussian_radius(cv::Size(0, 0), sigma), 3, budget,
+            [&](const cv::Mat& band, cv::Mat& result)
+        {
+            cv::Mat blurred;
+            cv::GaussianBlur(band, blurred, cv::Size(0, 0), sigma, sigma, cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED);
+
+            // subtract the blurred image from the original with weights
+            cv::addWeighted(band, amount, blurred, -(amount - 1), 0, result);
+        });
+        break;
+    }
+
+    case Operation::contour:
+    {
+        cv::Mat gray;
+
+        if (input.channels() == 1)
+        {
+            gray = input; // the banded blur writes a new buffer
+        }
+        else
+        {
+            cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
+        }
+
+        // pre filter blurring to control noise
+        int kernel_size = odd_kernel(step.kernel_size, scale);
+        tiled_gaussian_blur(gray, gray, cv::Size(kernel_size, kernel_size), 10.0 * scale, budget);
+
+        // edge tracking can run across the whole image, Canny itself is not split
+        cv::Mat edges;
+        cv::Canny(gray, edges, step.low_threshold, step.high_threshold);
+        gray.release();
+
+        // post filter blur to avoid sharp and pixelated lines
+        // (kept at its full size on a proxy, thinner edges would vanish in the preview)
+        tiled_gaussian_blur(edges, output, cv::Size(3, 3), 1.5, budget);
+
+        cv::bitwise_not(output, output); // invert
+        break;
+    }
+
+    case Operation::invert:
+        cv::bitwise_not(input, output);
+        break;
+
+    case Operation::grayscale:
+        if (input.channels() == 1)
+        {
+            output = input.clone();
+        }
+        else
+        {
+            cv::cvtColor(input, output, cv::COLOR_BGR2GRAY);
+        }
+        break;
+    }
+}
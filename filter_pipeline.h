@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <opencv2/opencv.hpp>
+#include "fast_blur.h"
+
+// Non-destructive filter stack over a decoded source image.
+// Filters are applied in the order they were first added, each node keeps its output, and
+// changing a node's parameters only recomputes that node and the ones after it, so moving
+// the contour slider of blur -> sharpen -> contour runs the contour stage alone.
+// A pipeline can also run on a downscaled proxy of the image: spatial parameters (kernel
+// sizes and sigmas) are multiplied by the proxy scale so the preview matches the full result.
+// The Gaussian stages run on horizontal bands in parallel, each band padded with halo rows so
+// the result is identical to a whole image blur.
+// The memory budget covers the source, the cached outputs and the temporary buffers of the
+// bands in flight. Over budget, intermediate outputs are dropped and recomputed when needed;
+// the last output and the input of the node edited last stay, so slider moves stay cheap.
+// The bands get what the cached frames leave of the budget.
+class FilterPipeline
+{
+public:
+    enum class Operation
+    {
+        blur,
+        sharpen,
+        contour,
+        invert,
+        grayscale
+    };
+
+    struct Step
+    {
+        Operation operation = Operation::blur;
+        int kernel_size = 3; // contour pre filter blur
+        double sigma = 3.0; // blur
+        FastBlur::Quality blur_quality = FastBlur::Quality::accurate;
+        double sharpen_amount = 1.5;
+        int low_threshold = 50; // contour
+        int high_threshold = 150;
+
+        bool same_parameters(const Step& other) const;
+    };
+
+    // BGR source, source_id tells a new image from the one already loaded,
+    // scale is the source size relative to the full resolution image
+    void set_source(const cv::Mat& source, qint64 source_id, double scale = 1.0);
+    bool has_source(qint64 source_id) const;
+    const cv::Mat& source() const;
+
+    // appends the operation, or updates it in place if it is already in the stack
+    void set_step(const Step& step);
+    void clear(); // drops the steps and the source
+
+    // source, cached outputs and band buffers together
+    void set_memory_budget(qint64 bytes);
+    qint64 cached_bytes() const; // source and outputs currently held
+
+    bool empty() const;
+    QString description() const; // e.g. "Blur + Sharpen"
+
+    // runs the nodes that are out of date, returns the source when the stack is empty
+    const cv::Mat& result();
+
+    static void apply(const Step& step, const cv::Mat& input, cv::Mat& output, double scale = 1.0,
+        qint64 budget = default_memory_budget);
+
+    static constexpr qint64 default_memory_budget = 256 * 1024 * 1024;
+
+private:
+    struct Node
+    {
+        Step step;
+        cv::Mat output;
+        bool valid = false;
+    };
+
+    void invalidate_from(int index);
+    void trim_cache(int keep); // drops outputs while over budget, keep is the one being read
+
+    static constexpr qint64 minimum_band_budget = 1024 * 1024; // bands still run when the frames fill the budget
+
+    cv::Mat m_source;
+    qint64 m_source_id = 0;
+    double m_scale = 1.0;
+    qint64 m_memory_budget = default_memory_budget;
+    QVector<Node> m_nodes;
+    int m_edited = -1; // node set_step changed last, its input is kept cached
+};
@@ -0,0 +1,127 @@
+#include "filter_worker.h"
+#include <QRunnable>
+
+
+FilterWorker::FilterWorker(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+FilterWorker::~FilterWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = Request();
+        m_has_pending = false;
+    }
+
+    m_pool.waitForDone(); // a running job still uses the viewer's pipelines
+}
+
+void FilterWorker::post(const Update& update, const Render& render)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (update)
+    {
+        m_pending.updates.append(update);
+    }
+
+    if (render)
+    {
+        m_pending.render = render; // newest wins
+    }
+
+    m_pending.ticket = ++m_ticket;
+    m_has_pending = true;
+
+    if (m_running)
+    {
+        return; // the running job picks it up when it's done
+    }
+
+    m_running = true;
+    m_pool.start(QRunnable::create([this]() { run(); }));
+}
+
+void FilterWorker::run()
+{
+    for (;;)
+    {
+        Request request;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_has_pending)
+            {
+                m_running = false;
+                return;
+            }
+
+            request = std::move(m_pending);
+            m_pending = Request();
+            m_has_pending = false;
+        }
+
+        for (const Update& update : request.updates)
+        {
+            update();
+        }
+
+        if (!request.render)
+        {
+            continue;
+        }
+
+        Show show = request.render();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // cancelled while it was rendering
+            if (request.ticket <= m_cancelled_ticket)
+            {
+                continue;
+            }
+
+            m_result = show;
+            m_result_ticket = request.ticket;
+        }
+
+        QMetaObject::invokeMethod(this, [this]() { deliver(); }, Qt::QueuedConnection);
+    }
+}
+
+void FilterWorker::deliver()
+{
+    Show show;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // an earlier call may have shown it already, a newer result replaces one that was not shown yet
+        if (!m_result || m_result_ticket <= m_cancelled_ticket)
+        {
+            m_result = Show();
+            return;
+        }
+
+        show = std::move(m_result);
+        m_result = Show();
+    }
+
+    if (show)
+    {
+        show();
+    }
+}
+
+void FilterWorker::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_pending.render = Render();
+    m_cancelled_ticket = m_ticket;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include <mutex>
+
+// Runs the viewer's filter work on one background thread, the newest request wins.
+// A request is a state update (setting a filter step, loading a source) and/or a render.
+// Updates always run, in the order they were posted, so a superseded request still leaves
+// its step in the filter stack; a render replaces the one waiting, so dragging a slider
+// keeps at most one render in flight and one waiting, whatever the number of intermediate
+// values. Finished renders are shown unless cancel() was called after they were posted.
+// Jobs run one at a time, so the state they touch (filter pipelines, the ASCII converter)
+// needs no locking as long as the GUI thread only changes it through post(). Nothing ever
+// waits for a job on the GUI thread, a job that needs GUI state gets a copy of it.
+class FilterWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Update = std::function<void()>;
+    using Show = std::function<void()>; // runs on the GUI thread, shows a finished render
+    using Render = std::function<Show()>; // runs on the worker thread
+
+    explicit FilterWorker(QObject* parent = nullptr);
+    ~FilterWorker();
+
+    // either part may be empty
+    void post(const Update& update, const Render& render = Render());
+
+    // drops the waiting render and the result of the running one, queued updates still run
+    void cancel();
+
+private:
+    struct Request
+    {
+        QVector<Update> updates;
+        Render render;
+        quint64 ticket = 0;
+    };
+
+    void run(); // worker thread, drains the pending request
+    void deliver(); // GUI thread
+
+    QThreadPool m_pool; // a single thread, jobs never overlap
+
+    std::mutex m_mutex; // guards everything below
+    Request m_pending;
+    bool m_has_pending = false;
+    bool m_running = false;
+    quint64 m_ticket = 0; // newest posted request
+    quint64 m_cancelled_ticket = 0; // results of requests up to this one are dropped
+    Show m_result; // finished render waiting for the GUI thread
+    quint64 m_result_ticket = 0;
+};
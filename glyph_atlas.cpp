@@ -0,0 +1,176 @@
+#include "glyph_atlas.h"
+
+using cv::Mat;
+using cv::Point;
+using cv::Rect;
+using cv::Scalar;
+using cv::Size;
+using std::max;
+using std::min;
+using std::string;
+
+
+GlyphAtlas::GlyphAtlas()
+{
+	m_slots.fill(-1);
+}
+
+void GlyphAtlas::build(const char* symbols, int count, int font_face, double font_scale, int thickness)
+{
+	m_glyphs.clear();
+	m_slots.fill(-1);
+	m_top = INT_MAX;
+	m_bottom = INT_MIN;
+
+	for (int i = 0; i < count; ++i)
+	{
+		string text(1, symbols[i]);
+
+		int base_line = 0;
+		Size text_size = cv::getTextSize(text, font_face, font_scale, thickness, &base_line);
+
+		// generous padding so antialiased edges and thick strokes are never clipped
+		int pad = thickness + 4;
+		Mat tile(text_size.height + base_line + 2 * pad, text_size.width + 2 * pad, CV_8UC1, Scalar(255));
+		Point origin(pad, pad + text_size.height);
+
+		// render black on white exactly like the original per character call did
+		cv::putText(tile, text, origin, font_face, font_scale, Scalar(0), thickness, cv::LINE_AA, false);
+
+		// ink coverage is the inverse of the rendered tile
+		Mat coverage;
+		cv::bitwise_not(tile, coverage);
+
+		Glyph glyph;
+		Rect ink = cv::boundingRect(coverage);
+
+		if (ink.area() > 0)
+		{
+			glyph.coverage = coverage(ink).clone(); // keep only the inked part
+			glyph.offset = ink.tl() - origin;
+
+			m_top = min(m_top, glyph.offset.y);
+			m_bottom = max(m_bottom, glyph.offset.y + ink.height);
+		}
+
+		m_slots[static_cast<unsigned char>(symbols[i])] = static_cast<int>(m_glyphs.size());
+		m_glyphs.push_back(glyph);
+	}
+
+	if (m_top > m_bottom) // nothing was inked
+	{
+		m_top = 0;
+		m_bottom = 0;
+	}
+
+	m_font_face = font_face;
+	m_font_scale = font_scale;
+	m_thickness = thickness;
+}
+
+bool GlyphAtlas::matches(int font_face, double font_scale, int thickness) const
+{
+	return !m_glyphs.empty() && m_font_face == font_face && m_font_scale == font_scale && m_thickness == thickness;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::find(char symbol) const
+{
+	int slot = m_slots[static_cast<unsigned char>(symbol)];
+
+	return slot < 0 ? nullptr : &m_glyphs[slot];
+}
+
+void GlyphAtlas::draw(Mat& canvas, char symbol, Point origin, const cv::Vec3b& color, int row_begin, int row_end) const
+{
+	const Glyph* glyph = find(symbol);
+
+	if (!glyph || glyph->coverage.empty())
+	{
+		return;
+	}
+
+	const Mat& mask = glyph->coverage;
+	Point top_left = origin + glyph->offset;
+
+	// clip the mask against the canvas borders and the requested row band
+	int col_start = max(0, -top_left.x);
+	int col_end = min(mask.cols, canvas.cols - top_left.x);
+	int row_start = max(0, max(row_begin, 0) - top_left.y);
+	int row_stop = min(mask.rows, min(row_end, canvas.rows) - top_left.y);
+
+	const int b = color[0];
+	const int g = color[1];
+	const int r = color[2];
+
+	// transparent canvas, glyph coverage becomes the alpha channel
+	if (canvas.channels() == 4)
+	{
+		for (int row = row_start; row < row_stop; ++row)
+		{
+			const uchar* alpha_row = mask.ptr<uchar>(row);
+			uchar* dst = canvas.ptr<uchar>(top_left.y + row) + 4 * (top_left.x + col_start);
+
+			for (int col = col_start; col < col_end; ++col, dst += 4)
+			{
+				const int alpha = alpha_row[col];
+
+				if (alpha == 0)
+				{
+					continue;
+				}
+
+				const int dst_alpha = dst[3];
+
+				if (alpha == 255 || dst_alpha == 0)
+				{
+					dst[0] = static_cast<uchar>(b);
+					dst[1] = static_cast<uchar>(g);
+					dst[2] = static_cast<uchar>(r);
+					dst[3] = static_cast<uchar>(max(alpha, dst_alpha));
+					continue;
+				}
+
+				// "over" compositing with straight (non premultiplied) alpha
+				const int below = dst_alpha * (255 - alpha); // weight of the existing pixel, scaled by 255
+				const int out_alpha = alpha * 255 + below; // scaled by 255
+
+				dst[0] = static_cast<uchar>((b * alpha * 255 + dst[0] * below + out_alpha / 2) / out_alpha);
+				dst[1] = static_cast<uchar>((g * alpha * 255 + dst[1] * below + out_alpha / 2) / out_alpha);
+				dst[2] = static_cast<uchar>((r * alpha * 255 + dst[2] * below + out_alpha / 2) / out_alpha);
+				dst[3] = static_cast<uchar>((out_alpha + 127) / 255);
+			}
+		}
+
+		return;
+	}
+
+	for (int row = row_start; row < row_stop; ++row)
+	{
+		const uchar* alpha_row = mask.ptr<uchar>(row);
+		uchar* dst = canvas.ptr<uchar>(top_left.y + row) + 3 * (top_left.x + col_start);
+
+		for (int col = col_start; col < col_end; ++col, dst += 3)
+		{
+			const int alpha = alpha_row[col];
+
+			if (alpha == 0)
+			{
+				continue;
+			}
+
+			if (alpha == 255)
+			{
+				dst[0] = static_cast<uchar>(b);
+				dst[1] = static_cast<uchar>(g);
+				dst[2] = static_cast<uchar>(r);
+				continue;
+			}
+
+			// dst = dst * (1 - a) + color * a, rounded
+			const int inverse = 255 - alpha;
+			dst[0] = static_cast<uchar>((dst[0] * inverse + b * alpha + 127) / 255);
+			dst[1] = static_cast<uchar>((dst[1] * inverse + g * alpha + 127) / 255);
+			dst[2] = static_cast<uchar>((dst[2] * inverse + r * alpha + 127) / 255);
+		}
+	}
+}
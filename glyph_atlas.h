@@ -0,0 +1,46 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <climits>
+#include <vector>
+
+// Pre-rendered coverage masks for the ASCII charset.
+// Every glyph is rasterized once with cv::putText and then blended into the output
+// with plain memory operations instead of re-running the Hershey rasterizer per cell.
+class GlyphAtlas
+{
+public:
+	struct Glyph
+	{
+		cv::Mat coverage; // CV_8UC1, 0 = background, 255 = full ink
+		cv::Point offset; // top left corner of the mask relative to the text origin
+	};
+
+	GlyphAtlas();
+
+	void build(const char* symbols, int count, int font_face, double font_scale, int thickness);
+	bool matches(int font_face, double font_scale, int thickness) const;
+
+	const Glyph* find(char symbol) const;
+
+	// vertical ink extent of the whole charset relative to the text origin
+	int top() const { return m_top; }
+	int bottom() const { return m_bottom; }
+
+	// alpha blends a glyph into a BGR canvas the same way putText does with LINE_AA
+	// on a BGRA canvas the coverage is composited into the alpha channel instead
+	// only canvas rows in [row_begin, row_end) are touched, so row bands can be drawn concurrently
+	void draw(cv::Mat& canvas, char symbol, cv::Point origin, const cv::Vec3b& color, int row_begin = 0, int row_end = INT_MAX) const;
+
+private:
+	std::vector<Glyph> m_glyphs;
+	std::array<int, 256> m_slots; // char value -> index into m_glyphs, -1 if not in the atlas
+
+	int m_font_face = -1;
+	double m_font_scale = 0.0;
+	int m_thickness = 0;
+
+	int m_top = 0;
+	int m_bottom = 0;
+};
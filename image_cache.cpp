@@ -0,0 +1,96 @@
+#include "image_cache.h"
+#include <QFileInfo>
+#include <climits>
+
+
+ImageCache::ImageCache(qint64 byte_budget)
+{
+    set_byte_budget(byte_budget);
+}
+
+void ImageCache::set_byte_budget(qint64 byte_budget)
+{
+    m_entries.setMaxCost(static_cast<int>(qMin<qint64>(byte_budget / 1024, INT_MAX)));
+}
+
+qint64 ImageCache::get_byte_budget() const
+{
+    return static_cast<qint64>(m_entries.maxCost()) * 1024;
+}
+
+bool ImageCache::find(const QString& path, Entry& entry)
+{
+    Entry* cached = m_entries.object(path); // also marks the entry as most recently used
+
+    if (!cached)
+    {
+        return false;
+    }
+
+    QFileInfo info(path);
+
+    // stale entry, the file was replaced or edited
+    if (!info.exists() || info.size() != cached->file_size || info.lastModified() != cached->modified)
+    {
+        m_entries.remove(path);
+        return false;
+    }
+
+    entry = *cached;
+    return true;
+}
+
+void ImageCache::insert(const QString& path, const QImage& full, const QPixmap& display)
+{
+    QFileInfo info(path);
+
+    Entry* entry = new Entry;
+    entry->full = full;
+    entry->display = display;
+    entry->file_size = info.size();
+    entry->modified = info.lastModified();
+
+    qint64 bytes = image_bytes(full) + pixmap_bytes(display);
+
+    // QCache takes ownership, and drops the entry right away if it is larger than the budget
+    m_entries.insert(path, entry, static_cast<int>(qMin<qint64>(bytes / 1024 + 1, INT_MAX)));
+}
+
+void ImageCache::attach_full(const QString& path, const QImage& full)
+{
+    Entry* cached = m_entries.object(path);
+
+    if (!cached)
+    {
+        return;
+    }
+
+    // reinsert so the cost reflects the bigger entry
+    QPixmap display = cached->display;
+    insert(path, full, display);
+}
+
+bool ImageCache::contains(const QString& path) const
+{
+    return m_entries.contains(path);
+}
+
+void ImageCache::remove(const QString& path)
+{
+    m_entries.remove(path);
+}
+
+void ImageCache::clear()
+{
+    m_entries.clear();
+}
+
+qint64 ImageCache::image_bytes(const QImage& image)
+{
+    return static_cast<qint64>(image.bytesPerLine()) * image.height();
+}
+
+qint64 ImageCache::pixmap_bytes(const QPixmap& pixmap)
+{
+    return static_cast<qint64>(pixmap.width()) * pixmap.height() * qMax(1, pixmap.depth() / 8);
+}
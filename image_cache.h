@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QCache>
+#include <QDateTime>
+#include <QImage>
+#include <QPixmap>
+#include <QString>
+
+// Memory budgeted LRU cache of decoded images for navigation.
+// Entries are keyed by path and validated against the file size and modification time,
+// so a file that changed on disk is decoded again.
+class ImageCache
+{
+public:
+    struct Entry
+    {
+        QImage full; // full resolution, null when only the display version was decoded
+        QPixmap display; // scaled to fit the view
+        qint64 file_size = 0;
+        QDateTime modified;
+    };
+
+    explicit ImageCache(qint64 byte_budget);
+
+    void set_byte_budget(qint64 byte_budget);
+    qint64 get_byte_budget() const;
+
+    // returns false on a miss or when the file changed since it was cached
+    bool find(const QString& path, Entry& entry);
+    void insert(const QString& path, const QImage& full, const QPixmap& display);
+    bool contains(const QString& path) const; // cheap check, no validation against the file
+    void attach_full(const QString& path, const QImage& full); // adds the full resolution image to an entry
+
+    void remove(const QString& path);
+    void clear();
+
+private:
+    static qint64 image_bytes(const QImage& image);
+    static qint64 pixmap_bytes(const QPixmap& pixmap);
+
+    QCache<QString, Entry> m_entries; // cost is in KiB so large budgets fit QCache's int cost
+};
@@ -0,0 +1,200 @@
+#include "image_decoder.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <opencv2/opencv.hpp>
+
+
+ImageDecoder::Format ImageDecoder::sniff(const QByteArray& data)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    const int size = data.size();
+
+    if (size >= 3 && bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF)
+    {
+        return Format::jpeg;
+    }
+
+    if (size >= 8 && data.startsWith("\x89PNG\r\n\x1a\n"))
+    {
+        return Format::png;
+    }
+
+    if (size >= 6 && (data.startsWith("GIF87a") || data.startsWith("GIF89a")))
+    {
+        return Format::gif;
+    }
+
+    if (size >= 2 && data.startsWith("BM"))
+    {
+        return Format::bmp;
+    }
+
+    if (size >= 4 && (data.startsWith(QByteArray("II*\0", 4)) || data.startsWith(QByteArray("MM\0*", 4))))
+    {
+        return Format::tiff;
+    }
+
+    if (size >= 12 && data.startsWith("RIFF") && data.mid(8, 4) == "WEBP")
+    {
+        return Format::webp;
+    }
+
+    return Format::unknown;
+}
+
+QSize ImageDecoder::image_size(const QByteArray& data)
+{
+    QBuffer buffer;
+    buffer.setData(data); // shares the bytes, no copy
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, qt_format_name(sniff(data)));
+    return reader.size();
+}
+
+const char* ImageDecoder::qt_format_name(Format format)
+{
+    switch (format)
+    {
+    case Format::jpeg: return "jpeg";
+    case Format::png: return "png";
+    case Format::gif: return "gif";
+    case Format::bmp: return "bmp";
+    case Format::tiff: return "tiff";
+    case Format::webp: return "webp";
+    default: return ""; // let Qt guess
+    }
+}
+
+ImageDecoder::Backend ImageDecoder::default_backend(Format format)
+{
+    if (format == Format::unknown)
+    {
+        return Backend::qt;
+    }
+
+    // Qt wherever a plugin is installed, tiff and webp plugins are optional
+    return QImageReader::supportedImageFormats().contains(qt_format_name(format)) ? Backend::qt : Backend::opencv;
+}
+
+ImageDecoder::Registry& ImageDecoder::registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+ImageDecoder::Backend ImageDecoder::backend_for(const QString& path, Format format)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    auto file = reg.files.find(path);
+
+    if (file != reg.files.end())
+    {
+        return file.value();
+    }
+
+    auto known = reg.formats.find(static_cast<int>(format));
+
+    if (known != reg.formats.end())
+    {
+        return known.value();
+    }
+
+    Backend backend = default_backend(format);
+    reg.formats.insert(static_cast<int>(format), backend);
+
+    return backend;
+}
+
+QImage ImageDecoder::decode(const QString& path, const QByteArray& data, const QSize& target_size)
+{
+    if (data.isEmpty())
+    {
+        return QImage();
+    }
+
+    Format format = sniff(data);
+    Backend backend = backend_for(path, format);
+
+    QImage image = backend == Backend::qt ? decode_qt(data, format, target_size) : decode_opencv(data, target_size);
+
+    if (!image.isNull())
+    {
+        return image;
+    }
+
+    // same bytes, other backend, nothing is read again
+    Backend fallback = backend == Backend::qt ? Backend::opencv : Backend::qt;
+    image = fallback == Backend::qt ? decode_qt(data, format, target_size) : decode_opencv(data, target_size);
+
+    if (!image.isNull())
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.files.insert(path, fallback);
+    }
+
+    return image;
+}
+
+QImage ImageDecoder::decode_qt(const QByteArray& data, Format format, const QSize& target_size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, qt_format_name(format));
+    QSize source_size = reader.size(); // header only
+
+    if (target_size.isValid() && source_size.isValid()
+        && (source_size.width() > target_size.width() || source_size.height() > target_size.height()))
+    {
+        reader.setScaledSize(source_size.scaled(target_size, Qt::KeepAspectRatio));
+    }
+
+    return reader.read();
+}
+
+QImage ImageDecoder::decode_opencv(const QByteArray& data, const QSize& target_size)
+{
+    int flags = cv::IMREAD_COLOR;
+
+    if (target_size.isValid())
+    {
+        QSize source_size = image_size(data);
+
+        if (source_size.isValid())
+        {
+            QSize target = source_size.scaled(target_size, Qt::KeepAspectRatio);
+
+            // shrink while decoding, never below the target
+            if (source_size.width() >= target.width() * 8 && source_size.height() >= target.height() * 8)
+            {
+                flags = cv::IMREAD_REDUCED_COLOR_8;
+            }
+            else if (source_size.width() >= target.width() * 4 && source_size.height() >= target.height() * 4)
+            {
+                flags = cv::IMREAD_REDUCED_COLOR_4;
+            }
+            else if (source_size.width() >= target.width() * 2 && source_size.height() >= target.height() * 2)
+            {
+                flags = cv::IMREAD_REDUCED_COLOR_2;
+            }
+        }
+    }
+
+    // wraps the (mapped) bytes, imdecode doesn't write to its input
+    cv::Mat encoded(1, data.size(), CV_8UC1, const_cast<char*>(data.constData()));
+    cv::Mat cv_img = cv::imdecode(encoded, flags);
+
+    if (cv_img.empty())
+    {
+        return QImage();
+    }
+
+    cv::cvtColor(cv_img, cv_img, cv::COLOR_BGR2RGB);
+
+    return QImage(cv_img.data, cv_img.cols, cv_img.rows, cv_img.step, QImage::Format_RGB888).copy();
+}
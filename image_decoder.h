@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <mutex>
+
+// Picks a decoder from the file contents instead of trying Qt first and OpenCV second.
+// The file is mapped once (see MappedFile), its magic bytes name the format, and the bytes
+// are decoded in memory by the backend registered for that format. If a backend fails for a
+// file the other one gets the same bytes, and the file is remembered so later views go
+// straight to the one that works.
+// All functions are thread safe.
+class ImageDecoder
+{
+public:
+    enum class Format
+    {
+        unknown,
+        jpeg,
+        png,
+        gif,
+        bmp,
+        tiff,
+        webp
+    };
+
+    enum class Backend
+    {
+        qt, // QImageReader, JPEG scales during the DCT and PNG decodes without a color conversion
+        opencv // cv::imdecode, for formats without a Qt plugin
+    };
+
+    static Format sniff(const QByteArray& data);
+    static QSize image_size(const QByteArray& data); // from the header only, invalid if unknown
+
+    // decodes the whole image, or close to target_size (aspect kept) when it is valid and smaller;
+    // the result is exactly target_size for Qt and a power of two reduction for OpenCV
+    static QImage decode(const QString& path, const QByteArray& data, const QSize& target_size = QSize());
+
+    static Backend backend_for(const QString& path, Format format);
+
+private:
+    static QImage decode_qt(const QByteArray& data, Format format, const QSize& target_size);
+    static QImage decode_opencv(const QByteArray& data, const QSize& target_size);
+    static const char* qt_format_name(Format format);
+    static Backend default_backend(Format format);
+
+    struct Registry
+    {
+        std::mutex mutex;
+        QHash<int, Backend> formats; // default backend per format, from the installed Qt plugins
+        QHash<QString, Backend> files; // files whose format default failed
+    };
+
+    static Registry& registry();
+};
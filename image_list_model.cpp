@@ -0,0 +1,298 @@
+#include "image_list_model.h"
+#include "directory_scanner.h"
+#include <QDir>
+#include <QSet>
+#include <algorithm>
+
+
+ImageListModel::ImageListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+    m_offsets.append(0);
+}
+
+int ImageListModel::rowCount(const QModelIndex& parent) const
+{
+    // flat list, items have no children
+    return parent.isValid() ? 0 : size();
+}
+
+QVariant ImageListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= size())
+    {
+        return QVariant();
+    }
+
+    // strings are only built for the rows the view asks about
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole)
+    {
+        return file_name(index.row());
+    }
+
+    if (role == path_role)
+    {
+        return path(index.row());
+    }
+
+    return QVariant();
+}
+
+void ImageListModel::reset(const QString& folder)
+{
+    beginResetModel();
+
+    m_folder = QDir(folder).absolutePath();
+
+    if (!m_folder.endsWith('/'))
+    {
+        m_folder += '/';
+    }
+
+    m_names.clear();
+    m_offsets.clear();
+    m_offsets.append(0);
+
+    endResetModel();
+}
+
+void ImageListModel::append(const QStringList& names)
+{
+    if (names.isEmpty())
+    {
+        return;
+    }
+
+    int first = size();
+
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(names.size()) - 1);
+
+    for (const QString& name : names)
+    {
+        append_name(name);
+    }
+
+    endInsertRows();
+}
+
+void ImageListModel::append_name(const QString& name)
+{
+    m_names.append(name.toUtf8());
+    m_offsets.append(static_cast<quint32>(m_names.size()));
+}
+
+void ImageListModel::apply_order(const QStringList& sorted_names)
+{
+    emit layoutAboutToBeChanged();
+
+    // look the rows the view holds on to up in the new order before the storage is rebuilt
+    QModelIndexList old_indexes = persistentIndexList();
+    QModelIndexList new_indexes;
+
+    for (const QModelIndex& old_index : old_indexes)
+    {
+        QString name = file_name(old_index.row());
+        auto it = std::lower_bound(sorted_names.begin(), sorted_names.end(), name, DirectoryScanner::name_less);
+
+        if (it != sorted_names.end() && *it == name)
+        {
+            new_indexes.append(index(static_cast<int>(it - sorted_names.begin())));
+        }
+        else
+        {
+            new_indexes.append(QModelIndex());
+        }
+    }
+
+    m_names.clear();
+    m_offsets.clear();
+    m_offsets.append(0);
+    m_offsets.reserve(sorted_names.size() + 1);
+
+    for (const QString& name : sorted_names)
+    {
+        append_name(name);
+    }
+
+    changePersistentIndexList(old_indexes, new_indexes);
+
+    emit layoutChanged();
+}
+
+void ImageListModel::sync(const QStringList& sorted_names, QStringList& removed, QStringList& added)
+{
+    removed.clear();
+    added.clear();
+
+    QSet<QString> wanted(sorted_names.begin(), sorted_names.end());
+
+    // drop the rows that are gone, back to front in runs so each run is one removal
+    for (int row = size() - 1; row >= 0; --row)
+    {
+        if (wanted.contains(file_name(row)))
+        {
+            continue;
+        }
+
+        int last = row;
+
+        while (row > 0 && !wanted.contains(file_name(row - 1)))
+        {
+            --row;
+        }
+
+        for (int gone = row; gone <= last; ++gone)
+        {
+            removed.append(file_name(gone));
+        }
+
+        remove_names(row, last);
+    }
+
+    // a scan that was interrupted may have left rows in directory order
+    QStringList kept;
+    kept.reserve(size());
+
+    for (int row = 0; row < size(); ++row)
+    {
+        kept.append(file_name(row));
+    }
+
+    if (!std::is_sorted(kept.begin(), kept.end(), DirectoryScanner::name_less))
+    {
+        std::sort(kept.begin(), kept.end(), DirectoryScanner::name_less);
+        apply_order(kept);
+    }
+
+    QSet<QString> present(kept.begin(), kept.end());
+
+    // every name before a run of new ones is already in the list, so the run goes in at its own index
+    for (int i = 0; i < sorted_names.size();)
+    {
+        if (present.contains(sorted_names[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        int first = i;
+
+        while (i < sorted_names.size() && !present.contains(sorted_names[i]))
+        {
+            ++i;
+        }
+
+        QStringList run = sorted_names.mid(first, i - first);
+        insert_names(first, run);
+        added.append(run);
+    }
+}
+
+int ImageListModel::find(const QString& name) const
+{
+    // binary search straight on the packed names
+    int low = 0;
+    int high = size();
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+
+        if (DirectoryScanner::name_less(file_name(middle), name))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low < size() && file_name(low) == name ? low : -1;
+}
+
+void ImageListModel::insert_names(int row, const QStringList& names)
+{
+    QByteArray packed;
+    QVector<quint32> lengths;
+
+    for (const QString& name : names)
+    {
+        QByteArray utf8 = name.toUtf8();
+        packed.append(utf8);
+        lengths.append(static_cast<quint32>(utf8.size()));
+    }
+
+    beginInsertRows(QModelIndex(), row, row + static_cast<int>(names.size()) - 1);
+
+    quint32 position = m_offsets[row];
+    m_names.insert(static_cast<int>(position), packed);
+
+    // the offsets behind the run move by its length
+    for (int i = row + 1; i < m_offsets.size(); ++i)
+    {
+        m_offsets[i] += static_cast<quint32>(packed.size());
+    }
+
+    QVector<quint32> run_offsets;
+
+    for (quint32 length : lengths)
+    {
+        position += length;
+        run_offsets.append(position);
+    }
+
+    // the first name takes the old offset at row, the others follow it
+    for (int i = 0; i < run_offsets.size(); ++i)
+    {
+        m_offsets.insert(row + 1 + i, run_offsets[i]);
+    }
+
+    endInsertRows();
+}
+
+void ImageListModel::remove_names(int first, int last)
+{
+    beginRemoveRows(QModelIndex(), first, last);
+
+    quint32 begin = m_offsets[first];
+    quint32 end = m_offsets[last + 1];
+
+    m_names.remove(static_cast<int>(begin), static_cast<int>(end - begin));
+    m_offsets.remove(first + 1, last - first + 1);
+
+    for (int i = first + 1; i < m_offsets.size(); ++i)
+    {
+        m_offsets[i] -= end - begin;
+    }
+
+    endRemoveRows();
+}
+
+int ImageListModel::size() const
+{
+    return static_cast<int>(m_offsets.size()) - 1;
+}
+
+QString ImageListModel::file_name(int row) const
+{
+    quint32 begin = m_offsets[row];
+    quint32 end = m_offsets[row + 1];
+
+    return QString::fromUtf8(m_names.constData() + begin, static_cast<int>(end - begin));
+}
+
+QString ImageListModel::path(int row) const
+{
+    return m_folder + file_name(row);
+}
+
+QString ImageListModel::relative_name(const QString& path) const
+{
+    return path.startsWith(m_folder) ? path.mid(m_folder.size()) : QString();
+}
+
+const QString& ImageListModel::folder() const
+{
+    return m_folder;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// File list of the current folder for the list view.
+// Names are stored back to back as UTF-8 in a single buffer with an offset table, the folder
+// is kept once, so 100k+ entries cost little more than the names themselves.
+class ImageListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int path_role = Qt::UserRole; // full path, read by the thumbnail delegate
+
+    explicit ImageListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void reset(const QString& folder); // empty list for a new folder
+    void append(const QStringList& names); // names relative to the folder, may include subfolders
+
+    // reorders to the given listing of the same names, selections follow their rows
+    void apply_order(const QStringList& sorted_names);
+
+    // brings the list in line with a new sorted listing through row removals and insertions,
+    // so the view keeps its selection and scroll position; reports the names that changed
+    void sync(const QStringList& sorted_names, QStringList& removed, QStringList& added);
+
+    int find(const QString& name) const; // row of a name once the list is sorted, -1 if absent
+
+    int size() const;
+    QString file_name(int row) const;
+    QString path(int row) const;
+    QString relative_name(const QString& path) const; // inverse of path(), empty outside the folder
+    const QString& folder() const;
+
+private:
+    void append_name(const QString& name);
+    void insert_names(int row, const QStringList& names);
+    void remove_names(int first, int last);
+
+    QString m_folder; // with a trailing separator
+    QByteArray m_names;
+    QVector<quint32> m_offsets; // start of each name in m_names, plus the end of the last one
+};
@@ -0,0 +1,226 @@
+#include "image_loader.h"
+#include "image_decoder.h"
+#include "mapped_file.h"
+#include <QThread>
+
+
+ImageLoader::ImageLoader(int display_max_x, int display_max_y, QObject* parent)
+    : QObject(parent), m_display_max_x(display_max_x), m_display_max_y(display_max_y)
+{
+    // leave a core for the GUI thread
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+ImageLoader::~ImageLoader()
+{
+    cancel_all();
+    m_pool.clear(); // drop jobs that haven't started
+    m_pool.waitForDone(); // running jobs still reference this object
+}
+
+void ImageLoader::load(const QString& path, quint64 generation)
+{
+    // only one foreground request is alive at a time
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+    {
+        it.value().generation = 0;
+    }
+
+    auto it = m_pending.find(path);
+
+    if (it != m_pending.end())
+    {
+        // a prefetch that is already decoding just answers the request when it finishes
+        if (it.value().job->started.load())
+        {
+            it.value().generation = generation;
+            return;
+        }
+
+        // still queued behind other work, requeue it at the front
+        it.value().job->cancelled.store(true);
+        m_pending.erase(it);
+    }
+
+    Pending pending;
+    pending.job = start_job(path, foreground_priority);
+    pending.generation = generation;
+    m_pending.insert(path, pending);
+}
+
+void ImageLoader::prefetch(const QStringList& paths)
+{
+    // cancel everything the user has moved past, but never the image being shown
+    for (auto it = m_pending.begin(); it != m_pending.end();)
+    {
+        if (it.value().generation == 0 && !paths.contains(it.key()))
+        {
+            it.value().job->cancelled.store(true);
+            it = m_pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        const QString& path = paths[i];
+
+        if (m_pending.contains(path))
+        {
+            continue;
+        }
+
+        Pending pending;
+        pending.job = start_job(path, static_cast<int>(paths.size()) - i); // nearest image first
+        m_pending.insert(path, pending);
+    }
+}
+
+ImageLoader::JobHandle ImageLoader::start_job(const QString& path, int priority)
+{
+    JobHandle job = std::make_shared<JobState>();
+
+    const int max_x = m_display_max_x;
+    const int max_y = m_display_max_y;
+
+    QRunnable* runnable = QRunnable::create([this, path, job, max_x, max_y]()
+    {
+        if (job->cancelled.load())
+        {
+            return;
+        }
+
+        job->started.store(true);
+
+        // display quality only, full resolution is decoded later if a filter or save needs it
+        QImage full;
+        QImage display = decode_for_display(path, max_x, max_y, full);
+
+        if (job->cancelled.load())
+        {
+            return;
+        }
+
+        // hand the result over to the GUI thread
+        QMetaObject::invokeMethod(this, [this, path, job, full, display]()
+        {
+            finish_job(path, job, full, display);
+        }, Qt::QueuedConnection);
+    });
+
+    m_pool.start(runnable, priority);
+
+    return job;
+}
+
+void ImageLoader::cancel_all()
+{
+    for (const Pending& pending : m_pending)
+    {
+        pending.job->cancelled.store(true);
+    }
+
+    m_pending.clear();
+}
+
+bool ImageLoader::is_pending(const QString& path) const
+{
+    return m_pending.contains(path);
+}
+
+void ImageLoader::finish_job(const QString& path, const JobHandle& job, const QImage& full, const QImage& display)
+{
+    // the entry may belong to a newer job for the same path
+    auto it = m_pending.find(path);
+
+    if (it == m_pending.end() || it.value().job != job)
+    {
+        return;
+    }
+
+    quint64 generation = it.value().generation;
+    m_pending.erase(it);
+
+    if (job->cancelled.load())
+    {
+        return;
+    }
+
+    if (generation != 0)
+    {
+        emit image_loaded(path, generation, full, display);
+    }
+    else if (!display.isNull())
+    {
+        emit image_ready(path, full, display);
+    }
+}
+
+QImage ImageLoader::decode_for_display(const QString& path, int max_x, int max_y, QImage& full)
+{
+    full = QImage();
+
+    // header and pixels are read from the same mapping, released again when the decode is done
+    // (a mapping kept around would fault if the file is truncated in place later)
+    MappedFile::Handle encoded = MappedFile::open(path);
+
+    if (!encoded)
+    {
+        return QImage();
+    }
+
+    QByteArray bytes = encoded->bytes();
+    QSize source_size = ImageDecoder::image_size(bytes); // read from the header, no pixel decoding yet
+
+    if (source_size.isValid() && needs_scaling(source_size, max_x, max_y))
+    {
+        // same target size scale_image_to_fit would produce
+        QSize target = source_size.scaled(max_x, max_y, Qt::KeepAspectRatio);
+        QImage decoded = ImageDecoder::decode(path, bytes, target);
+
+        if (decoded.isNull())
+        {
+            return QImage();
+        }
+
+        // a backend that can't reduce decodes everything, keep that work
+        if (decoded.size() == source_size)
+        {
+            full = decoded;
+        }
+
+        return decoded.size() == target ? decoded : scale_for_display(decoded, max_x, max_y);
+    }
+
+    // small enough to show as is (or no size in the header), the decoded image doubles as the full resolution one
+    full = ImageDecoder::decode(path, bytes);
+
+    if (full.isNull())
+    {
+        return QImage();
+    }
+
+    return scale_for_display(full, max_x, max_y);
+}
+
+bool ImageLoader::needs_scaling(const QSize& size, int max_x, int max_y)
+{
+    Q_UNUSED(max_x);
+
+    // same threshold as scale_image_to_fit
+    return !(size.height() < max_y && size.width() < max_y);
+}
+
+// mirrors ImageViewer::scale_image_to_fit for QImage, which unlike QPixmap may be used off the GUI thread
+QImage ImageLoader::scale_for_display(const QImage& image, int max_x, int max_y)
+{
+    if (!needs_scaling(image.size(), max_x, max_y))
+    {
+        return image;
+    }
+
+    return image.scaled(max_x, max_y, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
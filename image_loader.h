@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+// Decodes and display-scales images on worker threads.
+// load() serves the image the user asked for, tagged with the viewer's generation
+// counter so stale results can be ignored; prefetch() decodes the images the viewer
+// expects next and cancels anything that is no longer wanted.
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    ImageLoader(int display_max_x, int display_max_y, QObject* parent = nullptr);
+    ~ImageLoader();
+
+    // foreground request, always delivered through image_loaded (a null display image means decoding failed)
+    void load(const QString& path, quint64 generation);
+
+    // replaces the wanted set, earlier paths get a higher priority
+    void prefetch(const QStringList& paths);
+    void cancel_all();
+
+    bool is_pending(const QString& path) const;
+
+    // thread safe helpers shared with the worker jobs
+    // maps the file for the duration of the call and decodes straight to the display size where
+    // the format allows it (JPEG DCT scaling, reduced OpenCV decoding); full is only filled when
+    // the whole image was decoded anyway
+    static QImage decode_for_display(const QString& path, int max_x, int max_y, QImage& full);
+    static bool needs_scaling(const QSize& size, int max_x, int max_y);
+    static QImage scale_for_display(const QImage& image, int max_x, int max_y);
+
+signals:
+    // full may be null when only a reduced resolution version was decoded
+    void image_loaded(const QString& path, quint64 generation, const QImage& full, const QImage& display);
+    void image_ready(const QString& path, const QImage& full, const QImage& display); // prefetched
+
+private:
+    struct JobState
+    {
+        std::atomic<bool> cancelled{ false };
+        std::atomic<bool> started{ false };
+    };
+
+    using JobHandle = std::shared_ptr<JobState>;
+
+    struct Pending
+    {
+        JobHandle job;
+        quint64 generation = 0; // 0 = prefetch only, otherwise the foreground request it answers
+    };
+
+    JobHandle start_job(const QString& path, int priority);
+    void finish_job(const QString& path, const JobHandle& job, const QImage& full, const QImage& display);
+
+    QThreadPool m_pool;
+    QHash<QString, Pending> m_pending; // queued or running jobs, GUI thread only
+
+    int m_display_max_x;
+    int m_display_max_y;
+
+    static constexpr int foreground_priority = 1000; // ahead of any prefetch
+};
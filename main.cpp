@@ -1,4 +1,5 @@
 #include "Image_viewer.h"
+#include "batch_converter.h"
 #include <QtWidgets/QApplication>
 
 
@@ -8,6 +9,13 @@ int main(int argc, char *argv[])
     QCoreApplication::setOrganizationName("flioink");
     QCoreApplication::setApplicationName("Image Viewer App");
 
+    // headless ASCII conversion, no window is created
+    if (BatchConverter::is_batch_invocation(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        return BatchConverter::run_from_command_line(app.arguments());
+    }
+
     QApplication app(argc, argv);
     ImageViewer window;
     window.show();
@@ -0,0 +1,144 @@
+#include "mapped_file.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <climits>
+
+
+MappedFile::MappedFile(const QString& path)
+    : m_path(path), m_file(path)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_map)
+    {
+        m_file.unmap(m_map);
+    }
+}
+
+MappedFile::Registry& MappedFile::registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+MappedFile::Handle MappedFile::open(const QString& path)
+{
+    QFileInfo info(path);
+
+    // bytes() and the cv::Mat headers of the callers take an int length
+    if (!info.exists() || info.size() == 0 || info.size() > INT_MAX)
+    {
+        return Handle();
+    }
+
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    Registry& reg = registry();
+
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        Handle existing = reg.files.value(path).lock();
+
+        // reuse the mapping unless the file was replaced since
+        if (existing && existing->m_size == info.size() && existing->m_modified == modified)
+        {
+            return existing;
+        }
+    }
+
+    // mapping happens outside the lock, it may wait on a slow (network) file system
+    MappedFile* file = new MappedFile(path);
+    file->m_size = info.size();
+    file->m_modified = modified;
+
+    if (!file->load())
+    {
+        delete file;
+        return Handle();
+    }
+
+    Handle handle(file, &MappedFile::release);
+
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // another thread may have mapped the same file meanwhile, both mappings stay valid
+    reg.files.insert(path, handle);
+
+    return handle;
+}
+
+bool MappedFile::load()
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    m_size = m_file.size();
+
+    // the file may have grown since open() checked it
+    if (m_size > INT_MAX)
+    {
+        return false;
+    }
+
+    m_map = m_file.map(0, m_size);
+
+    if (m_map)
+    {
+        return true;
+    }
+
+    // not every file system can map, read it once instead
+    m_contents = m_file.readAll();
+    m_file.close();
+    m_size = m_contents.size();
+
+    return m_size > 0;
+}
+
+void MappedFile::release(MappedFile* file)
+{
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        auto it = reg.files.find(file->m_path);
+
+        // the entry may already point at a newer mapping of the file
+        if (it != reg.files.end() && it.value().expired())
+        {
+            reg.files.erase(it);
+        }
+    }
+
+    delete file;
+}
+
+const uchar* MappedFile::data() const
+{
+    return m_map ? m_map : reinterpret_cast<const uchar*>(m_contents.constData());
+}
+
+qint64 MappedFile::size() const
+{
+    return m_size;
+}
+
+const QString& MappedFile::path() const
+{
+    return m_path;
+}
+
+QByteArray MappedFile::bytes() const
+{
+    if (!m_map)
+    {
+        return m_contents;
+    }
+
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(m_map), static_cast<int>(m_size));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <memory>
+#include <mutex>
+
+// Read only memory mapping of an image file, shared by everyone decoding it.
+// open() hands out reference counted handles: while any handle to a file is alive, opening it
+// again returns the same mapping, so the header probe and the Qt and OpenCV decode paths never
+// read the file a second time. The mapping goes away with the last handle; hold handles only
+// for the duration of a decode, a mapping of a file that is truncated meanwhile faults on access.
+// Files that can't be mapped are read into memory once instead. All functions are thread safe.
+class MappedFile
+{
+public:
+    using Handle = std::shared_ptr<const MappedFile>;
+
+    // null when the file doesn't exist, is empty, is 2 GiB or larger, or can't be read
+    static Handle open(const QString& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uchar* data() const;
+    qint64 size() const;
+    const QString& path() const;
+
+    // wraps the mapping without copying, only valid while this handle is alive
+    QByteArray bytes() const;
+
+private:
+    MappedFile(const QString& path);
+
+    bool load();
+
+    static void release(MappedFile* file); // deleter of the handles
+
+    QString m_path;
+    QFile m_file; // has to stay open, closing it unmaps
+    uchar* m_map = nullptr;
+    QByteArray m_contents; // fallback when the file system doesn't support mapping
+    qint64 m_size = 0;
+    qint64 m_modified = 0; // ms since epoch, a changed file gets a new mapping
+
+    struct Registry
+    {
+        std::mutex mutex;
+        QHash<QString, std::weak_ptr<const MappedFile>> files;
+    };
+
+    static Registry& registry();
+};
@@ -0,0 +1,114 @@
+// Checks that the banded ASCII render is byte for byte the single band one.
+// Builds as its own executable from this file plus ascii_converter.cpp, glyph_atlas.cpp and
+// mapped_file.cpp. From the repository root, with the OpenCV 4 and Qt 6 development packages installed:
+//
+//   g++ -std=c++17 -O2 -fPIC tests/ascii_render_test.cpp ascii_converter.cpp glyph_atlas.cpp mapped_file.cpp \
+//       -o ascii_render_test $(pkg-config --cflags --libs opencv4 Qt6Core)
+//
+// (Qt 5 works the same with Qt5Core.) Exits with 1 and lists the mismatches when a band count differs.
+
+#include "../ascii_converter.h"
+#include <iostream>
+#include <vector>
+
+using std::endl;
+using std::vector;
+
+namespace
+{
+    // same kind of input as the benchmark, with a fixed seed so every run draws the same image
+    cv::Mat make_synthetic_image(cv::Size size)
+    {
+        cv::Mat image(size, CV_8UC3);
+
+        for (int y = 0; y < size.height; ++y)
+        {
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+
+            for (int x = 0; x < size.width; ++x)
+            {
+                row[x] = cv::Vec3b(static_cast<uchar>(x * 255 / size.width),
+                                   static_cast<uchar>(y * 255 / size.height),
+                                   static_cast<uchar>((x + y) & 0xFF));
+            }
+        }
+
+        cv::theRNG().state = 0x12345678;
+
+        cv::Mat noise(size, CV_8UC3);
+        cv::randu(noise, cv::Scalar(0, 0, 0), cv::Scalar(48, 48, 48));
+        image += noise;
+
+        return image;
+    }
+
+    bool same(const cv::Mat& a, const cv::Mat& b)
+    {
+        if (a.size() != b.size() || a.type() != b.type())
+        {
+            return false;
+        }
+
+        return a.empty() || cv::norm(a, b, cv::NORM_INF) == 0;
+    }
+}
+
+
+int main()
+{
+    // odd size so the bands don't split the rows evenly
+    const cv::Mat source = make_synthetic_image(cv::Size(1280, 853));
+
+    // the detail slider range of the viewer, plus a width in between
+    const vector<int> widths = { 55, 80, 137, 220 };
+
+    // more bands than rows clamps to one band per row
+    const vector<int> band_counts = { 2, 3, 7, 16, 1000 };
+
+    ASCIIConverter converter(widths.front());
+    converter.set_verbose(false);
+
+    int failures = 0;
+
+    for (int width : widths)
+    {
+        for (bool color : { false, true })
+        {
+            for (bool transparent : { false, true })
+            {
+                converter.set_worker_count(1);
+                converter.process(source, width, color);
+                cv::Mat reference = converter.render(color, transparent);
+
+                if (reference.empty())
+                {
+                    std::cerr << "width " << width << ": empty render" << endl;
+                    ++failures;
+                    continue;
+                }
+
+                for (int bands : band_counts)
+                {
+                    converter.set_worker_count(bands);
+                    cv::Mat banded = converter.render(color, transparent);
+
+                    if (!same(reference, banded))
+                    {
+                        std::cerr << "width " << width << (color ? " color" : " mono") << (transparent ? " transparent" : "")
+                                  << ", " << bands << " bands: differs from the single band render" << endl;
+                        ++failures;
+                    }
+                }
+            }
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " mismatches" << endl;
+        return 1;
+    }
+
+    std::cout << "banded renders match" << endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Checks how far FastBlur strays from cv::GaussianBlur over a range of sigmas.
+// Builds as its own executable from this file plus fast_blur.cpp. From the repository root, with the
+// OpenCV 4 development package installed:
+//
+//   g++ -std=c++17 -O2 tests/fast_blur_test.cpp fast_blur.cpp -o fast_blur_test $(pkg-config --cflags --libs opencv4)
+//
+// Exits with 1 and lists the sigmas that go over the bounds.
+
+#include "../fast_blur.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+using std::endl;
+using std::vector;
+
+namespace
+{
+    // gradients and noise, plus a hard edged rectangle where the box stack differs the most
+    cv::Mat make_test_image(cv::Size size)
+    {
+        cv::Mat image(size, CV_8UC3);
+
+        for (int y = 0; y < size.height; ++y)
+        {
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+
+            for (int x = 0; x < size.width; ++x)
+            {
+                row[x] = cv::Vec3b(static_cast<uchar>(x * 255 / size.width),
+                                   static_cast<uchar>(y * 255 / size.height),
+                                   static_cast<uchar>((x + y) & 0xFF));
+            }
+        }
+
+        cv::theRNG().state = 0x12345678;
+
+        cv::Mat noise(size, CV_8UC3);
+        cv::randu(noise, cv::Scalar(0, 0, 0), cv::Scalar(48, 48, 48));
+        image += noise;
+
+        cv::rectangle(image, cv::Rect(size.width / 4, size.height / 3, size.width / 3, size.height / 4),
+                      cv::Scalar(255, 255, 255), cv::FILLED);
+
+        return image;
+    }
+
+    struct Error
+    {
+        double max;
+        double mean;
+    };
+
+    Error difference(const cv::Mat& a, const cv::Mat& b)
+    {
+        cv::Mat diff;
+        cv::absdiff(a, b, diff);
+
+        double max = 0;
+        cv::minMaxLoc(diff.reshape(1), nullptr, &max);
+
+        cv::Scalar mean = cv::mean(diff);
+
+        return { max, (mean[0] + mean[1] + mean[2]) / 3.0 };
+    }
+
+    const char* name(FastBlur::Quality quality)
+    {
+        return quality == FastBlur::Quality::accurate ? "accurate" : "fast";
+    }
+}
+
+
+int main()
+{
+    const cv::Mat image = make_test_image(cv::Size(640, 480));
+
+    // below 2 FastBlur uses the exact kernel, above it the box stack
+    const vector<double> sigmas = { 1.0, 1.5, 2.0, 3.0, 5.0, 12.0, 25.0, 50.0 };
+
+    int failures = 0;
+
+    for (double sigma : sigmas)
+    {
+        cv::Mat reference;
+        cv::GaussianBlur(image, reference, cv::Size(0, 0), sigma, sigma, cv::BORDER_REFLECT_101);
+
+        for (FastBlur::Quality quality : { FastBlur::Quality::fast, FastBlur::Quality::accurate })
+        {
+            cv::Mat output;
+            FastBlur::apply(image, output, sigma, quality);
+
+            if (output.size() != reference.size() || output.type() != reference.type())
+            {
+                std::cerr << "sigma " << sigma << " " << name(quality) << ": output size or type differs" << endl;
+                ++failures;
+                continue;
+            }
+
+            Error error = difference(reference, output);
+
+            // the exact kernel must match, the box stack may be a few levels off at edges
+            // but close to the Gaussian on average, the float passes more so
+            double max_bound = sigma < 2.0 ? 0.0 : 12.0;
+            double mean_bound = sigma < 2.0 ? 0.0 : (quality == FastBlur::Quality::accurate ? 1.5 : 2.0);
+
+            std::cout << "sigma " << sigma << " " << name(quality) << ": max " << error.max << ", mean " << error.mean << endl;
+
+            if (error.max > max_bound || error.mean > mean_bound)
+            {
+                std::cerr << "sigma " << sigma << " " << name(quality) << ": error over the bound (max "
+                          << max_bound << ", mean " << mean_bound << ")" << endl;
+                ++failures;
+            }
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " failures" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Checks ImageListModel::sync round-trips: insertions, removals and renames against the sorted listing.
+// Builds as its own executable from this file plus image_list_model.cpp and directory_scanner.cpp, both
+// classes are QObjects so their moc output goes in too. From the repository root, with the Qt 6
+// development package installed (moc lives in Qt's libexec directory):
+//
+//   MOC=$(pkg-config --variable=libexecdir Qt6Core)/moc
+//   $MOC image_list_model.h -o moc_image_list_model.cpp && $MOC directory_scanner.h -o moc_directory_scanner.cpp
+//   g++ -std=c++17 -fPIC tests/image_list_model_test.cpp image_list_model.cpp directory_scanner.cpp \
+//       moc_image_list_model.cpp moc_directory_scanner.cpp -o image_list_model_test $(pkg-config --cflags --libs Qt6Core)
+//
+// (Qt 5 works the same with Qt5Core, moc is in its host_bins directory.) Exits with 1 and lists the failed steps.
+
+#include "../image_list_model.h"
+#include "../directory_scanner.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+using std::endl;
+
+namespace
+{
+    int failures = 0;
+
+    QStringList sorted(QStringList names)
+    {
+        std::sort(names.begin(), names.end(), DirectoryScanner::name_less);
+        return names;
+    }
+
+    void fail(const QString& step, const QString& what)
+    {
+        std::cerr << step.toStdString() << ": " << what.toStdString() << endl;
+        ++failures;
+    }
+
+    // the model must hold exactly the listing, in order, and find every name at its row
+    void check_rows(const ImageListModel& model, const QStringList& listing, const QString& step)
+    {
+        if (model.size() != listing.size())
+        {
+            fail(step, QString("%1 rows, expected %2").arg(model.size()).arg(listing.size()));
+            return;
+        }
+
+        for (int row = 0; row < listing.size(); ++row)
+        {
+            if (model.file_name(row) != listing[row])
+            {
+                fail(step, QString("row %1 is '%2', expected '%3'").arg(row).arg(model.file_name(row), listing[row]));
+                return;
+            }
+
+            if (model.path(row) != model.folder() + listing[row])
+            {
+                fail(step, QString("path of row %1 is '%2'").arg(row).arg(model.path(row)));
+                return;
+            }
+
+            if (model.find(listing[row]) != row)
+            {
+                fail(step, QString("find('%1') is %2, expected %3").arg(listing[row]).arg(model.find(listing[row])).arg(row));
+                return;
+            }
+        }
+    }
+
+    // syncs to the listing and compares the reported changes with the difference of the two listings
+    void sync_to(ImageListModel& model, const QStringList& listing, const QString& step)
+    {
+        QStringList before;
+
+        for (int row = 0; row < model.size(); ++row)
+        {
+            before.append(model.file_name(row));
+        }
+
+        QStringList expected_removed;
+        QStringList expected_added;
+
+        for (const QString& name : before)
+        {
+            if (!listing.contains(name))
+            {
+                expected_removed.append(name);
+            }
+        }
+
+        for (const QString& name : listing)
+        {
+            if (!before.contains(name))
+            {
+                expected_added.append(name);
+            }
+        }
+
+        QStringList removed;
+        QStringList added;
+        model.sync(listing, removed, added);
+
+        // removals are reported back to front, only the set matters
+        if (sorted(removed) != sorted(expected_removed))
+        {
+            fail(step, "removed '" + removed.join(", ") + "', expected '" + expected_removed.join(", ") + "'");
+        }
+
+        if (sorted(added) != sorted(expected_added))
+        {
+            fail(step, "added '" + added.join(", ") + "', expected '" + expected_added.join(", ") + "'");
+        }
+
+        check_rows(model, listing, step);
+
+        for (const QString& name : expected_removed)
+        {
+            if (model.find(name) != -1)
+            {
+                fail(step, "removed name '" + name + "' is still found");
+            }
+        }
+    }
+}
+
+
+int main()
+{
+    ImageListModel model;
+    model.reset("/tmp/images");
+
+    if (model.folder() != "/tmp/images/")
+    {
+        fail("reset", "folder is '" + model.folder() + "'");
+    }
+
+    // an interrupted scan leaves the rows in directory order, sync sorts them without reporting changes
+    model.append({ "b.png", "a.png", "d.png" });
+    model.append({ "c.png" });
+    sync_to(model, sorted({ "a.png", "b.png", "c.png", "d.png" }), "unsorted scan");
+
+    sync_to(model, sorted({ "0.png", "a.png", "aa.png", "b.png", "c.png", "d.png", "z1.png", "z2.png" }),
+            "insert at the front, in the middle and at the end");
+
+    sync_to(model, sorted({ "0.png", "c.png", "d.png", "z1.png" }), "remove runs");
+
+    sync_to(model, sorted({ "0.png", "d.png", "e.png", "z1.png" }), "rename");
+
+    sync_to(model, sorted({ "0.png", "D.png", "e.png", "z1.png" }), "rename that only changes case");
+
+    // multi byte names shift the packed offsets by more than their character count
+    sync_to(model, sorted({ "0.png", "D.png", QString::fromUtf8("\xc3\xa4pfel.png"), QString::fromUtf8("\xe6\x97\xa5\xe6\x9c\xac.jpg"),
+                            "e.png", "sub/f.png", "z1.png" }), "multi byte and subfolder names");
+
+    sync_to(model, sorted({ "0.png", QString::fromUtf8("\xe6\x97\xa5\xe6\x9c\xac.jpg"), "sub/f.png", "sub/g.png" }),
+            "mixed removals and insertions");
+
+    sync_to(model, QStringList(), "empty listing");
+
+    sync_to(model, sorted({ "x.png", "y.png" }), "fill after empty");
+
+    // random listings drawn from a fixed pool, each step keeps, drops and adds names at random
+    QStringList pool;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        pool.append(QString("img_%1_%2.png").arg(i % 37).arg(i));
+    }
+
+    std::mt19937 random(1234);
+
+    for (int round = 0; round < 50; ++round)
+    {
+        std::bernoulli_distribution keep(round % 5 == 0 ? 0.1 : 0.7);
+        QStringList listing;
+
+        for (const QString& name : pool)
+        {
+            if (keep(random))
+            {
+                listing.append(name);
+            }
+        }
+
+        sync_to(model, sorted(listing), QString("random round %1").arg(round));
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " failures" << endl;
+        return 1;
+    }
+
+    std::cout << "sync round-trips match" << endl;
+    return 0;
+}
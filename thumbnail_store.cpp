@@ -0,0 +1,483 @@
+#include "thumbnail_store.h"
+#include "image_decoder.h"
+#include "mapped_file.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <cstring>
+
+
+namespace
+{
+    const quint32 index_magic = 0x49565448; // "IVTH"
+    const quint32 index_version = 1;
+    const quint32 initial_slots = 256;
+}
+
+ThumbnailStore::ThumbnailStore(QObject* parent)
+    : QObject(parent)
+{
+    // thumbnails are background work, keep most of the cores for decoding the shown image
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    close();
+}
+
+void ThumbnailStore::open_folder(const QString& folder)
+{
+    QString absolute = QDir(folder).absolutePath();
+
+    if (absolute == m_folder && m_map)
+    {
+        return;
+    }
+
+    close();
+
+    QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+
+    if (!QDir().mkpath(cache_dir))
+    {
+        return;
+    }
+
+    // one pack per folder, named after the folder path
+    QString name = QString::fromLatin1(QCryptographicHash::hash(absolute.toUtf8(), QCryptographicHash::Sha1).toHex());
+
+    m_folder = absolute;
+    m_index_path = cache_dir + "/" + name + ".index";
+    m_folder_cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    m_pack.setFileName(cache_dir + "/" + name + ".pack");
+
+    if (!m_pack.open(QIODevice::ReadWrite))
+    {
+        return;
+    }
+
+    // an index without the matching pack contents (pack deleted or truncated) is useless
+    if (!load_index(m_index_path) || m_pack.size() < static_cast<qint64>(m_used_slots) * slot_bytes)
+    {
+        // no usable index, the pack contents are meaningless without it
+        m_index.clear();
+        m_free_slots.clear(); // holes of the rejected index would be handed out a second time
+        m_used_slots = 0;
+    }
+
+    m_capacity = static_cast<quint32>(m_pack.size() / slot_bytes);
+    ensure_capacity(qMax(m_used_slots, initial_slots));
+}
+
+void ThumbnailStore::close()
+{
+    if (m_folder_cancelled)
+    {
+        m_folder_cancelled->store(true);
+    }
+
+    m_pool.clear();
+    m_pool.waitForDone(); // running jobs only post results back, which are ignored once cancelled
+
+    flush();
+
+    if (m_map)
+    {
+        m_pack.unmap(m_map);
+        m_map = nullptr;
+    }
+
+    m_pack.close();
+
+    m_folder.clear();
+    m_index_path.clear();
+    m_index.clear();
+    m_requested.clear();
+    m_free_slots.clear();
+    m_capacity = 0;
+    m_used_slots = 0;
+    m_dirty = false;
+}
+
+QString ThumbnailStore::relative_key(const QString& path) const
+{
+    return QDir(m_folder).relativeFilePath(path);
+}
+
+QImage ThumbnailStore::find(const QString& path)
+{
+    if (!m_map)
+    {
+        return QImage();
+    }
+
+    auto it = m_index.find(relative_key(path));
+
+    if (it == m_index.end() || !validate(path, it.value()))
+    {
+        return QImage();
+    }
+
+    const IndexEntry& entry = it.value();
+    const uchar* slot = m_map + static_cast<qint64>(entry.slot) * slot_bytes;
+
+    // the const constructor keeps QImage from ever writing to the mapping
+    return QImage(slot, entry.width, entry.height, thumbnail_edge * 3, QImage::Format_RGB888);
+}
+
+bool ThumbnailStore::validate(const QString& path, IndexEntry& entry)
+{
+    // stat each file once per session, not on every repaint
+    if (entry.validated)
+    {
+        return true;
+    }
+
+    QFileInfo info(path);
+
+    if (!info.exists() || info.size() != entry.file_size || info.lastModified().toMSecsSinceEpoch() != entry.modified)
+    {
+        m_free_slots.append(entry.slot);
+        m_index.remove(relative_key(path));
+        m_dirty = true;
+        return false;
+    }
+
+    entry.validated = true;
+    return true;
+}
+
+void ThumbnailStore::request(const QString& path)
+{
+    if (!m_map || m_requested.contains(path) || !find(path).isNull())
+    {
+        return;
+    }
+
+    m_requested.insert(path);
+
+    CancelFlag cancelled = m_folder_cancelled;
+
+    QRunnable* runnable = QRunnable::create([this, path, cancelled]()
+    {
+        if (cancelled->load())
+        {
+            return;
+        }
+
+        // the key describes the file as it was before decoding, a later edit makes it stale again
+        QFileInfo info(path);
+        qint64 file_size = info.size();
+        qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+        QImage thumbnail = generate(path);
+
+        if (cancelled->load())
+        {
+            return;
+        }
+
+        QMetaObject::invokeMethod(this, [this, path, cancelled, thumbnail, file_size, modified]()
+        {
+            if (cancelled->load())
+            {
+                return;
+            }
+
+            m_requested.remove(path);
+
+            if (!thumbnail.isNull())
+            {
+                store(path, thumbnail, file_size, modified);
+                emit thumbnail_ready(path);
+            }
+
+            // write the index whenever the queue drains so a crash loses little work
+            if (m_requested.isEmpty())
+            {
+                flush();
+            }
+        }, Qt::QueuedConnection);
+    });
+
+    m_pool.start(runnable);
+}
+
+void ThumbnailStore::remove(const QString& path)
+{
+    auto it = m_index.find(relative_key(path));
+
+    if (it == m_index.end())
+    {
+        return;
+    }
+
+    m_free_slots.append(it.value().slot);
+    m_index.erase(it);
+    m_dirty = true;
+}
+
+void ThumbnailStore::revalidate()
+{
+    for (IndexEntry& entry : m_index)
+    {
+        entry.validated = false;
+    }
+}
+
+QImage ThumbnailStore::generate(const QString& path)
+{
+    // JPEG decodes at 1/8 scale straight away, other formats shrink afterwards
+    MappedFile::Handle file = MappedFile::open(path);
+
+    if (!file)
+    {
+        return QImage();
+    }
+
+    QImage small = ImageDecoder::decode(path, file->bytes(), QSize(thumbnail_edge, thumbnail_edge));
+
+    if (small.isNull())
+    {
+        return QImage();
+    }
+
+    if (small.width() > thumbnail_edge || small.height() > thumbnail_edge)
+    {
+        small = small.scaled(thumbnail_edge, thumbnail_edge, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return small.convertToFormat(QImage::Format_RGB888);
+}
+
+bool ThumbnailStore::ensure_capacity(quint32 slots)
+{
+    if (m_map && slots <= m_capacity)
+    {
+        return true;
+    }
+
+    quint32 capacity = qMax(m_capacity, initial_slots);
+
+    while (capacity < slots)
+    {
+        capacity *= 2;
+    }
+
+    // the mapping has to go before the file can grow, views handed out by find() die with it
+    if (m_map)
+    {
+        m_pack.unmap(m_map);
+        m_map = nullptr;
+    }
+
+    qint64 bytes = static_cast<qint64>(capacity) * slot_bytes;
+
+    if (m_pack.size() < bytes && !m_pack.resize(bytes))
+    {
+        return false;
+    }
+
+    m_capacity = capacity;
+    m_map = m_pack.map(0, bytes);
+
+    return m_map != nullptr;
+}
+
+quint32 ThumbnailStore::allocate_slot()
+{
+    if (!m_free_slots.isEmpty())
+    {
+        return m_free_slots.takeLast();
+    }
+
+    return m_used_slots++;
+}
+
+void ThumbnailStore::store(const QString& path, const QImage& thumbnail, qint64 file_size, qint64 modified)
+{
+    QString key = relative_key(path);
+    auto existing = m_index.find(key);
+
+    quint32 slot = existing != m_index.end() ? existing.value().slot : allocate_slot();
+
+    if (!ensure_capacity(slot + 1))
+    {
+        return;
+    }
+
+    uchar* destination = m_map + static_cast<qint64>(slot) * slot_bytes;
+    const int row_bytes = thumbnail.width() * 3;
+
+    for (int y = 0; y < thumbnail.height(); ++y)
+    {
+        std::memcpy(destination + y * thumbnail_edge * 3, thumbnail.constScanLine(y), row_bytes);
+    }
+
+    IndexEntry entry;
+    entry.file_size = file_size;
+    entry.modified = modified;
+    entry.slot = slot;
+    entry.width = static_cast<quint16>(thumbnail.width());
+    entry.height = static_cast<quint16>(thumbnail.height());
+    entry.validated = true;
+
+    m_index.insert(key, entry);
+    m_dirty = true;
+}
+
+bool ThumbnailStore::load_index(const QString& index_path)
+{
+    QFile file(index_path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+
+    m_index.clear();
+    m_free_slots.clear();
+    m_used_slots = 0;
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 edge = 0;
+    quint32 count = 0;
+
+    in >> magic >> version >> edge >> count;
+
+    // a different slot layout cannot be read back
+    if (in.status() != QDataStream::Ok || magic != index_magic || version != index_version || edge != thumbnail_edge)
+    {
+        return false;
+    }
+
+    // every slot must lie inside the pack, so a bogus count or slot can't size anything
+    const qint64 pack_slots = m_pack.size() / slot_bytes;
+
+    if (count > static_cast<quint64>(pack_slots))
+    {
+        return false;
+    }
+
+    m_index.reserve(static_cast<int>(count));
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        QString key;
+        IndexEntry entry;
+
+        in >> key >> entry.file_size >> entry.modified >> entry.slot >> entry.width >> entry.height;
+
+        if (in.status() != QDataStream::Ok)
+        {
+            return false;
+        }
+
+        if (entry.slot >= pack_slots || entry.width > thumbnail_edge || entry.height > thumbnail_edge)
+        {
+            return false;
+        }
+
+        m_index.insert(key, entry);
+        m_used_slots = qMax(m_used_slots, entry.slot + 1);
+    }
+
+    // holes left by stale entries of an earlier session
+    QVector<bool> used(static_cast<int>(m_used_slots), false);
+
+    for (const IndexEntry& entry : m_index)
+    {
+        // two files in one slot would overwrite each other
+        if (used[static_cast<int>(entry.slot)])
+        {
+            return false;
+        }
+
+        used[static_cast<int>(entry.slot)] = true;
+    }
+
+    for (quint32 slot = 0; slot < m_used_slots; ++slot)
+    {
+        if (!used[static_cast<int>(slot)])
+        {
+            m_free_slots.append(slot);
+        }
+    }
+
+    return true;
+}
+
+void ThumbnailStore::flush()
+{
+    if (!m_dirty || m_index_path.isEmpty())
+    {
+        return;
+    }
+
+    // the pack pages are written back by the OS, only the index needs an explicit write
+    QSaveFile file(m_index_path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << index_magic << index_version << static_cast<qint32>(thumbnail_edge) << static_cast<quint32>(m_index.size());
+
+    for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it)
+    {
+        const IndexEntry& entry = it.value();
+        out << it.key() << entry.file_size << entry.modified << entry.slot << entry.width << entry.height;
+    }
+
+    if (file.commit())
+    {
+        m_dirty = false;
+    }
+}
+
+ThumbnailDelegate::ThumbnailDelegate(ThumbnailStore* store, QObject* parent)
+    : QStyledItemDelegate(parent), m_store(store)
+{
+}
+
+void ThumbnailDelegate::initStyleOption(QStyleOptionViewItem* option, const QModelIndex& index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    QString path = index.data(path_role).toString();
+
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    // only rows that are being painted get looked up, and missing ones queued
+    QImage thumbnail = m_store->find(path);
+
+    if (thumbnail.isNull())
+    {
+        m_store->request(path);
+    }
+    else
+    {
+        option->icon = QIcon(QPixmap::fromImage(thumbnail));
+    }
+
+    // reserve the space either way so rows don't jump once the thumbnail arrives
+    option->features |= QStyleOptionViewItem::HasDecoration;
+    option->decorationSize = QSize(ThumbnailStore::thumbnail_edge, ThumbnailStore::thumbnail_edge);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStyledItemDelegate>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+// Persistent thumbnails for the file list.
+// Every folder gets one pack file of fixed size raw RGB888 slots, memory mapped, plus an
+// index keyed by relative path and validated against file size and modification time.
+// Missing thumbnails are generated on a worker pool; all pack and index access happens on
+// the GUI thread, so reads are plain QImage views into the mapping.
+class ThumbnailStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int thumbnail_edge = 64;
+
+    explicit ThumbnailStore(QObject* parent = nullptr);
+    ~ThumbnailStore();
+
+    void open_folder(const QString& folder);
+    void close();
+
+    // view into the mapped pack, no copy; valid until the next open_folder or generated thumbnail
+    // returns a null image when the thumbnail is missing or the file changed
+    QImage find(const QString& path);
+
+    // queues background generation unless it is already stored or queued
+    void request(const QString& path);
+
+    void remove(const QString& path); // file deleted or renamed, frees its slot
+    void revalidate(); // the folder changed, files are checked again the next time they are shown
+
+    void flush(); // writes the index to disk
+
+signals:
+    void thumbnail_ready(const QString& path);
+
+private:
+    struct IndexEntry
+    {
+        qint64 file_size = 0;
+        qint64 modified = 0; // ms since epoch
+        quint32 slot = 0;
+        quint16 width = 0;
+        quint16 height = 0;
+        bool validated = false; // checked against the file in this session
+    };
+
+    using CancelFlag = std::shared_ptr<std::atomic<bool>>;
+
+    static constexpr int slot_bytes = thumbnail_edge * thumbnail_edge * 3;
+
+    QString relative_key(const QString& path) const;
+    bool validate(const QString& path, IndexEntry& entry);
+    bool ensure_capacity(quint32 slots);
+    quint32 allocate_slot();
+    void store(const QString& path, const QImage& thumbnail, qint64 file_size, qint64 modified);
+    bool load_index(const QString& index_path);
+
+    static QImage generate(const QString& path);
+
+    QString m_folder;
+    QString m_index_path;
+    QFile m_pack;
+    uchar* m_map = nullptr;
+    quint32 m_capacity = 0; // slots in the pack file
+    quint32 m_used_slots = 0; // high water mark
+    QVector<quint32> m_free_slots; // slots of stale thumbnails
+    bool m_dirty = false;
+
+    QHash<QString, IndexEntry> m_index;
+    QSet<QString> m_requested;
+
+    QThreadPool m_pool;
+    CancelFlag m_folder_cancelled; // set when the folder changes, stops the running jobs
+};
+
+// Paints list rows with their stored thumbnail, the file path is read from path_role.
+class ThumbnailDelegate : public QStyledItemDelegate
+{
+public:
+    static constexpr int path_role = Qt::UserRole;
+
+    explicit ThumbnailDelegate(ThumbnailStore* store, QObject* parent = nullptr);
+
+protected:
+    void initStyleOption(QStyleOptionViewItem* option, const QModelIndex& index) const override;
+
+private:
+    ThumbnailStore* m_store;
+};